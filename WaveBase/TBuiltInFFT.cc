@@ -0,0 +1,439 @@
+#include "TBuiltInFFT.hh"
+#include <algorithm>
+#include <cmath>
+//______________________________________________________________________________
+//
+//  TBuiltInFFT
+//
+//  FFT engine without external dependencies, behind the interface of
+//  TFastFourierTransformFFTW (see TFastFourierTransformFFTW::SetEngine).  It
+//  is the default when the library is compiled without FFTW, so that the
+//  frequency-domain code keeps working, and can be selected at run time to
+//  compare with FFTW.
+//
+//  The complex transform is a recursive mixed-radix decimation in time (as
+//  in KISS FFT), with dedicated butterflies for radix 2, 3, 4 and 5 and a
+//  generic one for other primes up to kMaxRadix.  Lengths with larger prime
+//  factors use Bluestein's algorithm, i.e. a convolution with a chirp done
+//  with power-of-two transforms, so that no length costs O(N^2).  The
+//  butterflies are written out in real arithmetic: std::complex
+//  multiplication goes through a library call checking for infinities
+//  unless compiled with -ffast-math, and the plain loops let the compiler
+//  use SIMD instructions.
+//
+//  A real transform of even length N is done with a complex transform of
+//  length N/2 of the even and odd samples packed as real and imaginary
+//  parts, followed by an O(N) split, which halves the work.  Odd lengths use
+//  a complex transform of length N.  The real-to-real transforms (DCT and
+//  DST type II and III) are computed with one real transform of length N
+//  and O(N) pre- and post-processing (Makhoul's algorithm).
+//
+//  All transforms are unnormalized with the conventions of FFTW.
+//______________________________________________________________________________
+
+namespace {
+  typedef TBuiltInFFT::Complex Complex;
+
+  enum { kMaxRadix = 31 };
+
+  inline Complex Mul(const Complex& a, const Complex& b)
+  {
+    return Complex(a.real()*b.real() - a.imag()*b.imag(),
+                   a.real()*b.imag() + a.imag()*b.real());
+  }
+
+  inline Complex Polar(double phase)
+  {
+    return Complex(std::cos(phase), std::sin(phase));
+  }
+}
+
+//______________________________________________________________________________
+TBuiltInFFT::ComplexTransform::ComplexTransform(size_t length) :
+  fLength(length),
+  fConvolution(NULL)
+{
+  if (fLength <= 1) return;
+
+  // Radix 4 first, then 2, then odd primes
+  size_t n = fLength;
+  size_t p = 4;
+  bool useBluestein = false;
+  while (n > 1) {
+    while (n % p != 0) {
+      if (p == 4) p = 2;
+      else if (p == 2) p = 3;
+      else p += 2;
+      if (p*p > n) p = n;
+    }
+    if (p > kMaxRadix) {
+      useBluestein = true;
+      break;
+    }
+    n /= p;
+    fFactors.push_back(p);
+    fFactors.push_back(n);
+  }
+
+  if (!useBluestein) {
+    fTwiddles.resize(fLength);
+    for (size_t j=0;j<fLength;j++) fTwiddles[j] = Polar(-2*M_PI*j/fLength);
+    return;
+  }
+
+  // Bluestein: X_k = w_k sum_j (x_j w_j) conj(w_(k-j)), w_k = exp(-i pi k^2/N)
+  fFactors.clear();
+  size_t M = 1;
+  while (M < 2*fLength - 1) M *= 2;
+  fConvolution = new ComplexTransform(M);
+  fChirp.resize(fLength);
+  for (size_t k=0;k<fLength;k++) {
+    // k^2 mod 2N keeps the phase accurate for long transforms
+    unsigned long long k2 = (unsigned long long)k*k % (2*fLength);
+    fChirp[k] = Polar(-M_PI*k2/fLength);
+  }
+  std::vector<Complex> b(M, Complex(0., 0.));
+  b[0] = std::conj(fChirp[0]);
+  for (size_t j=1;j<fLength;j++) b[j] = b[M-j] = std::conj(fChirp[j]);
+  fChirpFT.resize(M);
+  fConvolution->Forward(&b[0], &fChirpFT[0]);
+  // Fold in the 1/M of the inverse transform
+  for (size_t k=0;k<M;k++) fChirpFT[k] *= 1./M;
+  fScratch.resize(2*M);
+}
+
+//______________________________________________________________________________
+TBuiltInFFT::ComplexTransform::~ComplexTransform()
+{
+  delete fConvolution;
+}
+
+//______________________________________________________________________________
+size_t TBuiltInFFT::ComplexTransform::GetScratchBytes() const
+{
+  size_t bytes = (fTwiddles.size() + fScratch.size() + fChirp.size() +
+                  fChirpFT.size())*sizeof(Complex);
+  if (fConvolution) bytes += fConvolution->GetScratchBytes();
+  return bytes;
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Forward(const Complex* in, Complex* out) const
+{
+  if (fLength == 0) return;
+  if (fConvolution) Bluestein(in, out);
+  else if (fFactors.empty()) out[0] = in[0];
+  else Work(out, in, 1, &fFactors[0]);
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Work(Complex* out, const Complex* in,
+                                         size_t fstride, const size_t* factors) const
+{
+  // Transform of the m*p samples in[q*fstride] into out[0..m*p), by p
+  // transforms of length m followed by radix-p butterflies.
+  const size_t p = factors[0];
+  const size_t m = factors[1];
+  if (m == 1) {
+    for (size_t q=0;q<p;q++) out[q] = in[q*fstride];
+  } else {
+    for (size_t q=0;q<p;q++) Work(out + q*m, in + q*fstride, fstride*p, factors + 2);
+  }
+  switch (p) {
+    case 2: Butterfly2(out, fstride, m); break;
+    case 3: Butterfly3(out, fstride, m); break;
+    case 4: Butterfly4(out, fstride, m); break;
+    case 5: Butterfly5(out, fstride, m); break;
+    default: ButterflyGeneric(out, fstride, m, p); break;
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Butterfly2(Complex* out, size_t fstride, size_t m) const
+{
+  double* f0 = reinterpret_cast<double*>(out);
+  double* f1 = reinterpret_cast<double*>(out + m);
+  const double* tw = reinterpret_cast<const double*>(&fTwiddles[0]);
+  for (size_t k=0;k<m;k++) {
+    const double* w = tw + 2*k*fstride;
+    double tr = f1[2*k]*w[0] - f1[2*k+1]*w[1];
+    double ti = f1[2*k]*w[1] + f1[2*k+1]*w[0];
+    f1[2*k]   = f0[2*k] - tr;
+    f1[2*k+1] = f0[2*k+1] - ti;
+    f0[2*k]   += tr;
+    f0[2*k+1] += ti;
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Butterfly3(Complex* out, size_t fstride, size_t m) const
+{
+  const double s = fTwiddles[fstride*m].imag();   // -sin(2 pi/3)
+  for (size_t k=0;k<m;k++) {
+    Complex s1 = Mul(out[m+k], fTwiddles[k*fstride]);
+    Complex s2 = Mul(out[2*m+k], fTwiddles[2*k*fstride]);
+    double sr = s1.real() + s2.real(), si = s1.imag() + s2.imag();
+    double dr = (s1.real() - s2.real())*s, di = (s1.imag() - s2.imag())*s;
+    double hr = out[k].real() - 0.5*sr, hi = out[k].imag() - 0.5*si;
+    out[k] = Complex(out[k].real() + sr, out[k].imag() + si);
+    out[m+k] = Complex(hr - di, hi + dr);
+    out[2*m+k] = Complex(hr + di, hi - dr);
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Butterfly4(Complex* out, size_t fstride, size_t m) const
+{
+  for (size_t k=0;k<m;k++) {
+    Complex s0 = Mul(out[m+k], fTwiddles[k*fstride]);
+    Complex s1 = Mul(out[2*m+k], fTwiddles[2*k*fstride]);
+    Complex s2 = Mul(out[3*m+k], fTwiddles[3*k*fstride]);
+    double ar = out[k].real() + s1.real(), ai = out[k].imag() + s1.imag();
+    double br = out[k].real() - s1.real(), bi = out[k].imag() - s1.imag();
+    double cr = s0.real() + s2.real(), ci = s0.imag() + s2.imag();
+    double dr = s0.real() - s2.real(), di = s0.imag() - s2.imag();
+    out[k]     = Complex(ar + cr, ai + ci);
+    out[2*m+k] = Complex(ar - cr, ai - ci);
+    out[m+k]   = Complex(br + di, bi - dr);
+    out[3*m+k] = Complex(br - di, bi + dr);
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Butterfly5(Complex* out, size_t fstride, size_t m) const
+{
+  const Complex ya = fTwiddles[fstride*m];
+  const Complex yb = fTwiddles[2*fstride*m];
+  for (size_t k=0;k<m;k++) {
+    Complex s0 = out[k];
+    Complex s1 = Mul(out[m+k], fTwiddles[k*fstride]);
+    Complex s2 = Mul(out[2*m+k], fTwiddles[2*k*fstride]);
+    Complex s3 = Mul(out[3*m+k], fTwiddles[3*k*fstride]);
+    Complex s4 = Mul(out[4*m+k], fTwiddles[4*k*fstride]);
+    Complex s7 = s1 + s4, s10 = s1 - s4, s8 = s2 + s3, s9 = s2 - s3;
+    out[k] = s0 + s7 + s8;
+    Complex s5(s0.real() + s7.real()*ya.real() + s8.real()*yb.real(),
+               s0.imag() + s7.imag()*ya.real() + s8.imag()*yb.real());
+    Complex s6(s10.imag()*ya.imag() + s9.imag()*yb.imag(),
+               -s10.real()*ya.imag() - s9.real()*yb.imag());
+    out[m+k] = s5 - s6;
+    out[4*m+k] = s5 + s6;
+    Complex s11(s0.real() + s7.real()*yb.real() + s8.real()*ya.real(),
+                s0.imag() + s7.imag()*yb.real() + s8.imag()*ya.real());
+    Complex s12(-s10.imag()*yb.imag() + s9.imag()*ya.imag(),
+                s10.real()*yb.imag() - s9.real()*ya.imag());
+    out[2*m+k] = s11 + s12;
+    out[3*m+k] = s11 - s12;
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::ButterflyGeneric(Complex* out, size_t fstride,
+                                                     size_t m, size_t p) const
+{
+  Complex scratch[kMaxRadix];
+  for (size_t u=0;u<m;u++) {
+    for (size_t q=0;q<p;q++) scratch[q] = out[u + q*m];
+    for (size_t q1=0, k=u;q1<p;q1++, k+=m) {
+      Complex sum = scratch[0];
+      size_t twidx = 0;
+      for (size_t q=1;q<p;q++) {
+        twidx += fstride*k;
+        if (twidx >= fLength) twidx -= fLength;
+        sum += Mul(scratch[q], fTwiddles[twidx]);
+      }
+      out[k] = sum;
+    }
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::ComplexTransform::Bluestein(const Complex* in, Complex* out) const
+{
+  const size_t M = fConvolution->GetLength();
+  Complex* a = &fScratch[0];
+  Complex* A = &fScratch[M];
+  for (size_t j=0;j<fLength;j++) a[j] = Mul(in[j], fChirp[j]);
+  for (size_t j=fLength;j<M;j++) a[j] = Complex(0., 0.);
+  fConvolution->Forward(a, A);
+  // Inverse transform as conj(Forward(conj(.)))
+  for (size_t k=0;k<M;k++) A[k] = std::conj(Mul(A[k], fChirpFT[k]));
+  fConvolution->Forward(A, a);
+  for (size_t k=0;k<fLength;k++) out[k] = Mul(std::conj(a[k]), fChirp[k]);
+}
+
+//______________________________________________________________________________
+TBuiltInFFT::TBuiltInFFT(size_t length) :
+  fLength(length),
+  fComplex(NULL)
+{
+  if (fLength == 0) return;
+  if (fLength % 2 == 0) {
+    const size_t half = fLength/2;
+    fComplex = new ComplexTransform(half);
+    fTwiddles.resize(half + 1);
+    for (size_t k=0;k<=half;k++) fTwiddles[k] = Polar(-2*M_PI*k/fLength);
+    fWork.resize(half);
+  } else {
+    fComplex = new ComplexTransform(fLength);
+    fWork.resize(fLength);
+    fSpectrum.resize(fLength);
+  }
+}
+
+//______________________________________________________________________________
+TBuiltInFFT::~TBuiltInFFT()
+{
+  delete fComplex;
+}
+
+//______________________________________________________________________________
+size_t TBuiltInFFT::GetScratchBytes() const
+{
+  size_t bytes = (fTwiddles.size() + fWork.size() + fSpectrum.size() +
+                  fQuarterTwiddles.size() + fRealSpectrum.size())*sizeof(Complex) +
+                 (fReal.size() + fTemp.size())*sizeof(double);
+  if (fComplex) bytes += fComplex->GetScratchBytes();
+  return bytes;
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::PerformFFT(const double* in, Complex* out) const
+{
+  // out[k] = sum_j in[j] exp(-2 pi i jk/N) for k = 0..N/2
+  if (fLength == 0) return;
+  if (fLength % 2 != 0) {
+    for (size_t j=0;j<fLength;j++) fWork[j] = Complex(in[j], 0.);
+    fComplex->Forward(&fWork[0], &fSpectrum[0]);
+    std::copy(fSpectrum.begin(), fSpectrum.begin() + fLength/2 + 1, out);
+    return;
+  }
+
+  // Z_k = E_k + i O_k, E and O the transforms of the even and odd samples
+  const size_t half = fLength/2;
+  fComplex->Forward(reinterpret_cast<const Complex*>(in), &fWork[0]);
+  const double* Z = reinterpret_cast<const double*>(&fWork[0]);
+  const double* W = reinterpret_cast<const double*>(&fTwiddles[0]);
+  double* X = reinterpret_cast<double*>(out);
+  for (size_t k=0;k<=half;k++) {
+    const size_t a = (k == half) ? 0 : k;
+    const size_t b = (k == 0) ? 0 : half - k;
+    // E = (Z_k + conj(Z_(N/2-k)))/2, O = (Z_k - conj(Z_(N/2-k)))/(2i)
+    double er = 0.5*(Z[2*a] + Z[2*b]),     ei = 0.5*(Z[2*a+1] - Z[2*b+1]);
+    double orr = 0.5*(Z[2*a+1] + Z[2*b+1]), oi = -0.5*(Z[2*a] - Z[2*b]);
+    X[2*k]   = er + W[2*k]*orr - W[2*k+1]*oi;
+    X[2*k+1] = ei + W[2*k]*oi + W[2*k+1]*orr;
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::PerformInverseFFT(const Complex* in, double* out) const
+{
+  // out[j] = sum_k in[k] exp(2 pi i jk/N) over the full hermitian spectrum,
+  // i.e. N times the inverse.  As with FFTW, the imaginary parts of the DC
+  // and Nyquist bins are ignored.
+  if (fLength == 0) return;
+  const size_t half = fLength/2;
+  if (fLength % 2 != 0) {
+    // Inverse as conj(Forward(conj(.))), the real part is all we need
+    fWork[0] = Complex(in[0].real(), 0.);
+    for (size_t k=1;k<=half;k++) {
+      fWork[k] = std::conj(in[k]);
+      fWork[fLength-k] = in[k];
+    }
+    fComplex->Forward(&fWork[0], &fSpectrum[0]);
+    for (size_t j=0;j<fLength;j++) out[j] = fSpectrum[j].real();
+    return;
+  }
+
+  // 2 Z_k = (X_k + conj(X_(N/2-k))) + i exp(2 pi i k/N) (X_k - conj(X_(N/2-k))),
+  // whose inverse of length N/2 gives N (x_2j + i x_2j+1).
+  const double* X = reinterpret_cast<const double*>(in);
+  const double* W = reinterpret_cast<const double*>(&fTwiddles[0]);
+  double* Z = reinterpret_cast<double*>(&fWork[0]);
+  for (size_t k=0;k<half;k++) {
+    const size_t b = half - k;
+    double ar = X[2*k],  ai = (k == 0) ? 0. : X[2*k+1];
+    double br = X[2*b],  bi = (b == half) ? 0. : X[2*b+1];
+    double sr = ar + br, si = ai - bi;
+    double dr = ar - br, di = ai + bi;
+    // t = conj(W_k) d
+    double tr = W[2*k]*dr + W[2*k+1]*di;
+    double ti = W[2*k]*di - W[2*k+1]*dr;
+    // conj(s + i t)
+    Z[2*k]   = sr - ti;
+    Z[2*k+1] = -(si + tr);
+  }
+  Complex* z = reinterpret_cast<Complex*>(out);
+  fComplex->Forward(&fWork[0], z);
+  for (size_t j=0;j<half;j++) out[2*j+1] = -out[2*j+1];
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::PerformRealTransform(const double* in, double* out,
+                                       ERealTransform kind) const
+{
+  if (fLength == 0) return;
+  if (fQuarterTwiddles.size() != fLength) {
+    fQuarterTwiddles.resize(fLength);
+    for (size_t k=0;k<fLength;k++) fQuarterTwiddles[k] = Polar(-M_PI*k/(2.*fLength));
+    fRealSpectrum.resize(fLength/2 + 1);
+    fReal.resize(fLength);
+    fTemp.resize(fLength);
+  }
+  double* temp = &fTemp[0];
+  switch (kind) {
+    case kDCTII:
+      DCTII(in, out);
+      break;
+    case kDCTIII:
+      DCTIII(in, out);
+      break;
+    case kDSTII:
+      // DST-II(x)_k = DCT-II((-1)^j x_j)_(N-1-k)
+      for (size_t j=0;j<fLength;j++) temp[j] = (j % 2) ? -in[j] : in[j];
+      DCTII(temp, out);
+      std::reverse(out, out + fLength);
+      break;
+    case kDSTIII:
+      // DST-III(X)_j = (-1)^j DCT-III(X_(N-1-k))_j
+      for (size_t k=0;k<fLength;k++) temp[k] = in[fLength-1-k];
+      DCTIII(temp, out);
+      for (size_t j=1;j<fLength;j+=2) out[j] = -out[j];
+      break;
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::DCTII(const double* in, double* out) const
+{
+  // y_k = 2 sum_j x_j cos(pi (2j+1) k/(2N)) = 2 Re(exp(-i pi k/(2N)) V_k),
+  // V the transform of v = (x_0, x_2, x_4, ..., x_5, x_3, x_1).
+  double* v = &fReal[0];
+  for (size_t j=0;2*j<fLength;j++) v[j] = in[2*j];
+  for (size_t j=0;2*j+1<fLength;j++) v[fLength-1-j] = in[2*j+1];
+  PerformFFT(v, &fRealSpectrum[0]);
+  const size_t half = fLength/2;
+  for (size_t k=0;k<fLength;k++) {
+    Complex V = (k <= half) ? fRealSpectrum[k] : std::conj(fRealSpectrum[fLength-k]);
+    const Complex& q = fQuarterTwiddles[k];
+    out[k] = 2*(q.real()*V.real() - q.imag()*V.imag());
+  }
+}
+
+//______________________________________________________________________________
+void TBuiltInFFT::DCTIII(const double* in, double* out) const
+{
+  // Transpose of DCTII: V_k = exp(i pi k/(2N)) (X_k - i X_(N-k)) is
+  // hermitian, its inverse transform gives v, and y is v unpermuted.
+  const size_t half = fLength/2;
+  for (size_t k=0;k<=half;k++) {
+    const double a = in[k];
+    const double b = (k == 0) ? 0. : in[fLength-k];
+    fRealSpectrum[k] = Mul(std::conj(fQuarterTwiddles[k]), Complex(a, -b));
+  }
+  double* v = &fReal[0];
+  PerformInverseFFT(&fRealSpectrum[0], v);
+  for (size_t j=0;2*j<fLength;j++) out[2*j] = v[j];
+  for (size_t j=0;2*j+1<fLength;j++) out[2*j+1] = v[fLength-1-j];
+}
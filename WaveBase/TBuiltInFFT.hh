@@ -0,0 +1,106 @@
+/**
+ *
+ * CLASS DECLARATION:  TBuiltInFFT.hh
+ *
+ * DESCRIPTION:
+ *
+ * Self-contained mixed-radix real FFT, used by TFastFourierTransformFFTW
+ * when FFTW is not available or not selected.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TBuiltInFFT_hh
+#define WAVE_TBuiltInFFT_hh
+
+#include <complex>
+#include <vector>
+
+class TBuiltInFFT
+{
+  public:
+    typedef std::complex<double> Complex;
+
+    // Complex DFT of length points, see TBuiltInFFT.cc.
+    class ComplexTransform
+    {
+      public:
+        ComplexTransform(size_t length);
+        virtual ~ComplexTransform();
+
+        // out[k] = sum_j in[j] exp(-2 pi i jk/length), in and out must not
+        // overlap.
+        void Forward(const Complex* in, Complex* out) const;
+        size_t GetLength() const { return fLength; }
+        size_t GetScratchBytes() const;
+
+      protected:
+        void Work(Complex* out, const Complex* in, size_t fstride,
+                  const size_t* factors) const;
+        void Butterfly2(Complex* out, size_t fstride, size_t m) const;
+        void Butterfly3(Complex* out, size_t fstride, size_t m) const;
+        void Butterfly4(Complex* out, size_t fstride, size_t m) const;
+        void Butterfly5(Complex* out, size_t fstride, size_t m) const;
+        void ButterflyGeneric(Complex* out, size_t fstride, size_t m, size_t p) const;
+        void Bluestein(const Complex* in, Complex* out) const;
+
+        size_t               fLength;
+        std::vector<size_t>  fFactors;    // radix, remaining length, ...
+        std::vector<Complex> fTwiddles;   // exp(-2 pi i j/length)
+        mutable std::vector<Complex> fScratch;
+
+        // Bluestein's algorithm for lengths with large prime factors
+        ComplexTransform*    fConvolution; //!
+        std::vector<Complex> fChirp;
+        std::vector<Complex> fChirpFT;
+
+      private:
+        ComplexTransform(const ComplexTransform&);
+        ComplexTransform& operator=(const ComplexTransform&);
+    };
+
+    TBuiltInFFT(size_t length);
+    virtual ~TBuiltInFFT();
+
+    // Same conventions as FFTW's r2c and (unnormalized) c2r transforms:
+    // length real samples <-> length/2 + 1 complex bins.
+    void PerformFFT(const double* in, Complex* out) const;
+    void PerformInverseFFT(const Complex* in, double* out) const;
+
+    // Real-to-real transforms with the conventions of FFTW's REDFT10,
+    // REDFT01, RODFT10 and RODFT01, in the order of
+    // TFastFourierTransformFFTW::ERealTransform.  in and out may be the
+    // same.
+    enum ERealTransform { kDCTII, kDCTIII, kDSTII, kDSTIII };
+    void PerformRealTransform(const double* in, double* out, ERealTransform kind) const;
+
+    size_t GetLength() const { return fLength; }
+    size_t GetScratchBytes() const;
+
+  protected:
+    void DCTII(const double* in, double* out) const;
+    void DCTIII(const double* in, double* out) const;
+
+    size_t               fLength;
+    ComplexTransform*    fComplex;       //! length/2 (even) or length (odd)
+    std::vector<Complex> fTwiddles;      // exp(-2 pi i k/length), k <= length/2
+    mutable std::vector<Complex> fWork;
+    mutable std::vector<Complex> fSpectrum;  // full spectrum, odd lengths
+
+    // For the real-to-real transforms, made on first use
+    mutable std::vector<Complex> fQuarterTwiddles; // exp(-i pi k/(2 length))
+    mutable std::vector<Complex> fRealSpectrum;
+    mutable std::vector<double>  fReal;
+    mutable std::vector<double>  fTemp;
+
+  private:
+    TBuiltInFFT(const TBuiltInFFT&);
+    TBuiltInFFT& operator=(const TBuiltInFFT&);
+};
+
+#endif /* WAVE_TBuiltInFFT_hh */
@@ -0,0 +1,94 @@
+#include "TEncodedWaveform.hh"
+//______________________________________________________________________________
+//
+//  TEncodedWaveform
+//
+//  Holds an integer waveform compressed with TWaveformCodec together with
+//  its sampling frequency and time offset.  This is the object to write to
+//  a file (or a TTree branch) when raw ADC traces should be stored
+//  compactly:
+//
+//    TEncodedWaveform enc;
+//    enc.Encode(shortWF);
+//    enc.Write("wf0");
+//
+//  and to read them back:
+//
+//    TShortWaveform shortWF;
+//    enc->Decode(shortWF);
+//
+//  The payload is already compact, so ROOT compression of the branch can be
+//  set to a fast algorithm or switched off.
+//______________________________________________________________________________
+ClassImp(TEncodedWaveform)
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TEncodedWaveform::EncodeWF(const TTemplWaveform<_Tp>& wf, Int_t type,
+                                TWaveformCodec::EPredictor pred)
+{
+  fType = type;
+  fSampleFreq = wf.GetSamplingFreq();
+  fTOffset = wf.GetTOffset();
+  TWaveformCodec::Encode(wf, fPayload, pred);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+bool TEncodedWaveform::DecodeWF(TTemplWaveform<_Tp>& wf, Int_t type) const
+{
+  if (fType != type) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongType,
+      "Encoded waveform has a different type");
+    return false;
+  }
+  if (fPayload.size() == 0 ||
+      !TWaveformCodec::Decode(&fPayload[0], fPayload.size(), wf)) return false;
+  wf.SetSamplingFreq(fSampleFreq);
+  wf.SetTOffset(fTOffset);
+  return true;
+}
+
+//______________________________________________________________________________
+void TEncodedWaveform::Encode(const TShortWaveform& wf, TWaveformCodec::EPredictor pred)
+{
+  EncodeWF(wf, kShort, pred);
+}
+
+//______________________________________________________________________________
+void TEncodedWaveform::Encode(const TUShortWaveform& wf, TWaveformCodec::EPredictor pred)
+{
+  EncodeWF(wf, kUShort, pred);
+}
+
+//______________________________________________________________________________
+void TEncodedWaveform::Encode(const TIntWaveform& wf, TWaveformCodec::EPredictor pred)
+{
+  EncodeWF(wf, kInt, pred);
+}
+
+//______________________________________________________________________________
+bool TEncodedWaveform::Decode(TShortWaveform& wf) const
+{
+  return DecodeWF(wf, kShort);
+}
+
+//______________________________________________________________________________
+bool TEncodedWaveform::Decode(TUShortWaveform& wf) const
+{
+  return DecodeWF(wf, kUShort);
+}
+
+//______________________________________________________________________________
+bool TEncodedWaveform::Decode(TIntWaveform& wf) const
+{
+  return DecodeWF(wf, kInt);
+}
+
+//______________________________________________________________________________
+size_t TEncodedWaveform::GetLength() const
+{
+  // Number of samples of the encoded waveform.
+  if (fPayload.size() == 0) return 0;
+  return TWaveformCodec::GetEncodedLength(&fPayload[0], fPayload.size());
+}
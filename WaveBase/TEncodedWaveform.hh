@@ -0,0 +1,65 @@
+/**
+ *
+ * CLASS DECLARATION:  TEncodedWaveform.hh
+ *
+ * DESCRIPTION:
+ *
+ * Persistable, losslessly compressed integer waveform (see TWaveformCodec).
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TEncodedWaveform_hh
+#define WAVE_TEncodedWaveform_hh
+
+#ifndef WAVE_TWaveformCodec_hh
+#include "TWaveformCodec.hh"
+#endif
+
+class TEncodedWaveform : public TObject
+{
+  public:
+    enum EType { kUnknown = 0, kShort = 1, kUShort = 2, kInt = 3 };
+
+    TEncodedWaveform() : fType(kUnknown), fSampleFreq(CLHEP::megahertz),
+                         fTOffset(0.0) {}
+
+    void Encode(const TShortWaveform& wf,
+                TWaveformCodec::EPredictor pred = TWaveformCodec::kDelta);
+    void Encode(const TUShortWaveform& wf,
+                TWaveformCodec::EPredictor pred = TWaveformCodec::kDelta);
+    void Encode(const TIntWaveform& wf,
+                TWaveformCodec::EPredictor pred = TWaveformCodec::kDelta);
+
+    // Decoding into a type other than the one encoded fails and returns false.
+    bool Decode(TShortWaveform& wf) const;
+    bool Decode(TUShortWaveform& wf) const;
+    bool Decode(TIntWaveform& wf) const;
+
+    Int_t    GetType() const { return fType; }
+    size_t   GetLength() const;
+    size_t   GetEncodedSize() const { return fPayload.size(); }
+    Double_t GetSamplingFreq() const { return fSampleFreq; }
+    Double_t GetTOffset() const { return fTOffset; }
+
+  protected:
+    template<typename _Tp>
+    void EncodeWF(const TTemplWaveform<_Tp>& wf, Int_t type,
+                  TWaveformCodec::EPredictor pred);
+    template<typename _Tp>
+    bool DecodeWF(TTemplWaveform<_Tp>& wf, Int_t type) const;
+
+    Int_t                fType;       // Type of the encoded waveform (EType)
+    Double_t             fSampleFreq; // Sampling frequency
+    Double_t             fTOffset;    // Time offset
+    std::vector<UChar_t> fPayload;    // Encoded samples
+
+  ClassDef(TEncodedWaveform, 1)
+};
+
+#endif /* WAVE_TEncodedWaveform_hh */
@@ -1,5 +1,25 @@
 #include "TExpWindowAverage.hh"
 #include "TMath.h"
+#include <cmath>
+
+namespace {
+  template<size_t W>
+  void ExpWindowLanes(double* block, size_t n, double alpha, 
+                      const double* average, double* last)
+  {
+    // W channels in lock-step, the loops over lanes are vectorized.
+    double y[W], avg[W];
+    for (size_t l=0;l<W;l++) { y[l] = last[l]; avg[l] = average[l]; }
+    for (size_t i=0;i<n;i++) {
+      double* row = block + i*W;
+      for (size_t l=0;l<W;l++) {
+        y[l] = alpha*std::fabs(row[l] - avg[l]) + (1-alpha)*y[l];
+        row[l] = y[l];
+      }
+    }
+    for (size_t l=0;l<W;l++) last[l] = y[l];
+  }
+}
 
 //______________________________________________________________________________
 // TExpWindowAverage
@@ -14,11 +34,47 @@ void TExpWindowAverage::TransformInPlace(TDoubleWaveform& input) const
     // y[i] = alpha*abs(y[i]-avg) + (1-alpha)*y[i-1]
     //
 
+    // The average is subtracted inside the recursion, saving a pass over
+    // the waveform.  TIIRFilter is the general version of this filter.
+
+    if (input.GetLength() == 0) return;
     double average = input.Sum()/input.GetLength();  
-    input -= average;
-    input[0] = fAlpha*TMath::Abs(input[0]); 
+    double* data = input.GetData();
+    double last = fAlpha*TMath::Abs(data[0] - average); 
+    data[0] = last;
     for (size_t i=1;i<input.size();i++) {
-        input[i] = fAlpha*TMath::Abs(input[i]) + (1-fAlpha)*input[i-1]; 
+        last = fAlpha*TMath::Abs(data[i] - average) + (1-fAlpha)*last; 
+        data[i] = last;
     }
 }
 
+
+void TExpWindowAverage::TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const
+{
+    // Runs fBatchWidth waveforms at once, each in one lane of a transposed
+    // block.  Results are identical to TransformInPlace.
+
+    const size_t W = fBatchWidth;
+    double average[16], last[16];
+    fLaneBlock.resize(W*kLaneBlockLength);
+    for (size_t first=0;first<waveforms.size();first+=W) {
+        for (size_t l=0;l<W;l++) {
+            last[l] = 0.0; 
+            average[l] = 0.0;
+            if (first+l >= waveforms.size()) continue;
+            const TDoubleWaveform& wf = *waveforms[first+l];
+            if (wf.GetLength() > 0) average[l] = wf.Sum()/wf.GetLength();
+        }
+        size_t length = GetMaxLength(waveforms, first, W);
+        for (size_t start=0;start<length;start+=kLaneBlockLength) {
+            size_t n = std::min(length - start, (size_t)kLaneBlockLength);
+            GatherLanes(waveforms, first, W, start, n, &fLaneBlock[0]);
+            switch (W) {
+              case 4:  ExpWindowLanes<4>(&fLaneBlock[0], n, fAlpha, average, last); break;
+              case 16: ExpWindowLanes<16>(&fLaneBlock[0], n, fAlpha, average, last); break;
+              default: ExpWindowLanes<8>(&fLaneBlock[0], n, fAlpha, average, last); break;
+            }
+            ScatterLanes(waveforms, first, W, start, n, &fLaneBlock[0]);
+        }
+    }
+}
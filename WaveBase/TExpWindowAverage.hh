@@ -33,6 +33,7 @@ class TExpWindowAverage : public TVWaveformTransformer
     
   protected:
     virtual void TransformInPlace(TDoubleWaveform& input) const;
+    virtual void TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const;
     double fAlpha;
   
 };
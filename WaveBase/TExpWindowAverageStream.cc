@@ -0,0 +1,71 @@
+#include "TExpWindowAverageStream.hh"
+#include "TMath.h"
+
+//______________________________________________________________________________
+// TExpWindowAverageStream
+// 
+//   Chunk-wise version of TExpWindowAverage, for traces too long to hold in
+//   memory.  The recursion
+//
+//     y[i] = alpha*abs(x[i]-avg) + (1-alpha)*y[i-1]
+//
+//   continues across chunk boundaries.  Since the average of the whole trace
+//   is not known in advance, avg is either set with SetBaseline() or
+//   estimated from the first SetBaselineSamples() samples (default 1000);
+//   these samples are held back until the estimate is available.
+//
+
+void TExpWindowAverageStream::ResetState()
+{
+  fHaveBaseline = fFixedBaseline;
+  if (!fFixedBaseline) fBaseline = 0.0;
+  fPrevious = 0.0;
+  fFirst = true;
+  fPending.SetLength(0);
+}
+
+void TExpWindowAverageStream::Average(const double* in, size_t n, TDoubleWaveform& output)
+{
+  size_t offset = output.GetLength();
+  output.SetLength(offset + n);
+  double* out = output.GetData();
+  double prev = fPrevious;
+  size_t i = 0;
+  if (fFirst && n > 0) {
+    prev = fAlpha*TMath::Abs(in[0] - fBaseline);
+    out[offset] = prev;
+    fFirst = false;
+    i = 1;
+  }
+  for (;i<n;i++) {
+    prev = fAlpha*TMath::Abs(in[i] - fBaseline) + (1-fAlpha)*prev;
+    out[offset + i] = prev;
+  }
+  fPrevious = prev;
+}
+
+void TExpWindowAverageStream::ProcessChunk(const TDoubleWaveform& chunk, TDoubleWaveform& output)
+{
+  if (fHaveBaseline) {
+    // Samples held before SetBaseline was called come first
+    if (fPending.GetLength() > 0) FinishStream(output);
+    Average(chunk.GetData(), chunk.GetLength(), output);
+    return;
+  }
+  fPending.GetVectorData().insert(fPending.end(), chunk.begin(), chunk.end());
+  if (fPending.GetLength() < fBaselineSamples) return;
+  FinishStream(output);
+}
+
+void TExpWindowAverageStream::FinishStream(TDoubleWaveform& output)
+{
+  // Also used to release the held samples once enough have been collected.
+  if (!fHaveBaseline && fPending.GetLength() > 0) {
+    size_t n = (fBaselineSamples > 0 && fBaselineSamples < fPending.GetLength()) ?
+      fBaselineSamples : fPending.GetLength();
+    fBaseline = fPending.Sum(0, n)/n;
+    fHaveBaseline = true;
+  }
+  Average(fPending.GetData(), fPending.GetLength(), output);
+  fPending.SetLength(0);
+}
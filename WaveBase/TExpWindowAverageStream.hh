@@ -0,0 +1,55 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TExpWindowAverageStream.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Streaming version of TExpWindowAverage.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TExpWindowAverageStream_hh
+#define WAVE_TExpWindowAverageStream_hh
+
+#ifndef WAVE_TVWaveformStreamTransformer_hh
+#include "TVWaveformStreamTransformer.hh" 
+#endif
+
+class TExpWindowAverageStream : public TVWaveformStreamTransformer
+{
+  public:
+    TExpWindowAverageStream() : TVWaveformStreamTransformer("TExpWindowAverageStream"), 
+      fAlpha(0.5), fBaselineSamples(1000), fBaseline(0.0), fHaveBaseline(false),
+      fFixedBaseline(false), fPrevious(0.0), fFirst(true) {}
+
+    void SetAlpha(double alpha) { fAlpha = alpha; }
+    // The average removed from the trace is estimated from the first
+    // samples of the stream, unless a fixed baseline is given.
+    void SetBaselineSamples(size_t samples) { fBaselineSamples = samples; }
+    void SetBaseline(double baseline)
+      { fBaseline = baseline; fFixedBaseline = true; fHaveBaseline = true; }
+    double GetBaseline() const { return fBaseline; }
+    
+  protected:
+    virtual void ResetState();
+    virtual void ProcessChunk(const TDoubleWaveform& chunk, TDoubleWaveform& output);
+    virtual void FinishStream(TDoubleWaveform& output);
+    void Average(const double* in, size_t n, TDoubleWaveform& output);
+
+    double          fAlpha;
+    size_t          fBaselineSamples;
+    double          fBaseline;
+    bool            fHaveBaseline;
+    bool            fFixedBaseline;
+    double          fPrevious;  // last output, carried across chunks
+    bool            fFirst;
+    TDoubleWaveform fPending;   // samples held until the baseline is known
+};
+
+#endif /* WAVE_TExpWindowAverageStream_hh */
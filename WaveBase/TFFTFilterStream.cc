@@ -0,0 +1,104 @@
+#include "TFFTFilterStream.hh"
+#include "TFastFourierTransformFFTW.hh"
+#include "TSpectrumKernels.hh"
+
+//______________________________________________________________________________
+// TFFTFilterStream
+// 
+//   Convolves a long trace with an impulse response h (FIR filter), chunk
+//   by chunk, using the overlap-save method.  Each block of fFFTLength
+//   samples holds the last M-1 input samples of the previous block (M the
+//   length of h) followed by L = fFFTLength - M + 1 new samples; one
+//   forward FFT, a multiplication with the transform of h and one inverse
+//   FFT give L output samples.  The output is the causal convolution
+//
+//     y[n] = sum_k h[k]*x[n-k]
+//
+//   with the trace taken as zero before its start, and it has the same
+//   length as the input.  Output is emitted once a block is full, so it lags
+//   the input by at most L samples.
+//
+
+void TFFTFilterStream::SetImpulseResponse(const TDoubleWaveform& h, size_t fftLength,
+                                          TFastFourierTransformFFTW::EPadding padding)
+{
+  fKernelLength = h.GetLength();
+  if (fKernelLength == 0) {
+    std::cerr << "Impulse response is empty" << std::endl;
+    fFFTLength = 0;
+    return;
+  }
+  if (fftLength == 0) {
+    fftLength = 1;
+    while (fftLength < 4*fKernelLength) fftLength *= 2;
+  } else if (padding == TFastFourierTransformFFTW::kPadToFastLength) {
+    fftLength = TFastFourierTransformFFTW::GetFastLength(fftLength);
+  }
+  if (fftLength < fKernelLength) {
+    std::cerr << "FFT length shorter than the impulse response" << std::endl;
+    fFFTLength = 0;
+    return;
+  }
+  fFFTLength = fftLength;
+  TDoubleWaveform padded;
+  padded.MakeSimilarTo(h);
+  padded.SetLength(fFFTLength);
+  padded.Zero();
+  for (size_t i=0;i<fKernelLength;i++) padded[i] = h[i];
+  TFastFourierTransformFFTW::GetFFT(fFFTLength).PerformFFT(padded, fKernelFT);
+  // Fold the 1/N of the unnormalised inverse transform into the kernel
+  TSpectrumKernels::Scale(fKernelFT, 1./fFFTLength);
+  ResetState();
+}
+
+void TFFTFilterStream::ResetState()
+{
+  fFill = 0;
+  fBlock.SetLength(fFFTLength);
+  fBlock.Zero();
+}
+
+void TFFTFilterStream::FilterBlock(double* out, size_t n)
+{
+  // Filter the current block, write the first n of its new output samples
+  // to out and keep the last M-1 inputs as the overlap of the next block.
+  TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(fFFTLength);
+  fft.PerformFFT(fBlock, fBlockFT);
+  TSpectrumKernels::Multiply(fBlockFT, fKernelFT);
+  fft.PerformInverseFFTDestroyInput(fResult, fBlockFT);
+  const size_t overlap = fKernelLength - 1;
+  for (size_t i=0;i<n;i++) out[i] = fResult[overlap + i];
+  for (size_t i=0;i<overlap;i++) fBlock[i] = fBlock[fFFTLength - overlap + i];
+  fFill = 0;
+}
+
+void TFFTFilterStream::ProcessChunk(const TDoubleWaveform& chunk, TDoubleWaveform& output)
+{
+  if (fFFTLength == 0) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotConfigured,
+      "No impulse response set");
+    return;
+  }
+  const size_t overlap = fKernelLength - 1;
+  const size_t step = fFFTLength - overlap;
+  fBlock.SetSamplingFreq(chunk.GetSamplingFreq());
+  output.SetLength(((fFill + chunk.GetLength())/step)*step);
+  double* out = output.GetData();
+  for (size_t i=0;i<chunk.GetLength();i++) {
+    fBlock[overlap + fFill++] = chunk[i];
+    if (fFill == step) {
+      FilterBlock(out, step);
+      out += step;
+    }
+  }
+}
+
+void TFFTFilterStream::FinishStream(TDoubleWaveform& output)
+{
+  if (fFFTLength == 0 || fFill == 0) return;
+  const size_t overlap = fKernelLength - 1;
+  size_t n = fFill;
+  for (size_t i=overlap+fFill;i<fFFTLength;i++) fBlock[i] = 0.0;
+  output.SetLength(n);
+  FilterBlock(output.GetData(), n);
+}
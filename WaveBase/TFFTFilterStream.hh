@@ -0,0 +1,57 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TFFTFilterStream.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Streaming FIR filter using FFT overlap-save.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TFFTFilterStream_hh
+#define WAVE_TFFTFilterStream_hh
+
+#ifndef WAVE_TVWaveformStreamTransformer_hh
+#include "TVWaveformStreamTransformer.hh" 
+#endif
+#ifndef _WAVE_TFastFourierTransformFFTW_HH
+#include "TFastFourierTransformFFTW.hh" 
+#endif
+
+class TFFTFilterStream : public TVWaveformStreamTransformer
+{
+  public:
+    TFFTFilterStream() : TVWaveformStreamTransformer("TFFTFilterStream"), 
+      fFFTLength(0), fFill(0), fKernelLength(0) {}
+
+    // Set the impulse response h of the filter.  fftLength is the block
+    // length used for the transforms; by default the smallest power of two
+    // at least four times the length of h.  With kPadToFastLength, a given
+    // fftLength is rounded up to the next fast FFT length.
+    void SetImpulseResponse(const TDoubleWaveform& h, size_t fftLength = 0,
+                            TFastFourierTransformFFTW::EPadding padding = 
+                              TFastFourierTransformFFTW::kExactLength);
+    size_t GetFFTLength() const { return fFFTLength; }
+    
+  protected:
+    virtual void ResetState();
+    virtual void ProcessChunk(const TDoubleWaveform& chunk, TDoubleWaveform& output);
+    virtual void FinishStream(TDoubleWaveform& output);
+    void FilterBlock(double* out, size_t n);
+
+    size_t          fFFTLength;
+    size_t          fFill;      // new samples in the current block
+    size_t          fKernelLength;
+    TWaveformFT     fKernelFT;  // transform of the zero-padded h
+    TDoubleWaveform fBlock;     // overlap (fKernelLength-1) + new samples
+    TWaveformFT     fBlockFT;
+    TDoubleWaveform fResult;
+};
+
+#endif /* WAVE_TFFTFilterStream_hh */
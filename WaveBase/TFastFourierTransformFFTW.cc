@@ -1,4 +1,7 @@
 #include "TFastFourierTransformFFTW.hh"
+#include "TBuiltInFFT.hh"
+#include "TStopwatch.h"
+#include <algorithm>
 #ifdef USE_ROOT_FFTW
 // The following is to avoid using ROOT's cludgy interface.  fftw_plan_dft_r2c
 // is defined in libFFTW, but we also need the header information (copied
@@ -11,16 +14,32 @@ extern "C" {
 #endif
 
 #define FFTW_EXTERN extern
+enum fftw_r2r_kind_do_not_use_me {
+     FFTW_R2HC=0, FFTW_HC2R=1, FFTW_DHT=2,
+     FFTW_REDFT00=3, FFTW_REDFT01=4, FFTW_REDFT10=5, FFTW_REDFT11=6,
+     FFTW_RODFT00=7, FFTW_RODFT01=8, FFTW_RODFT10=9, FFTW_RODFT11=10
+};
 #define FFTW_DEFINE_API(X, R, C)                                           \
                                                                            \
 FFTW_DEFINE_COMPLEX(R, C);                                                 \
                                                                            \
 typedef struct X(plan_s) *X(plan);                                         \
                                                                            \
+typedef enum fftw_r2r_kind_do_not_use_me X(r2r_kind);                      \
+                                                                           \
 FFTW_EXTERN void X(execute)(const X(plan) p);                              \
                                                                            \
+FFTW_EXTERN void X(execute_dft_c2r)(const X(plan) p, C *in, R *out);       \
+                                                                           \
+FFTW_EXTERN void X(execute_r2r)(const X(plan) p, R *in, R *out);           \
+                                                                           \
+FFTW_EXTERN X(plan) X(plan_r2r)(int rank, const int *n, R *in, R *out,     \
+                        const X(r2r_kind) *kind, unsigned flags);          \
+                                                                           \
 FFTW_EXTERN void X(destroy_plan)(X(plan) p);                               \
                                                                            \
+FFTW_EXTERN int X(alignment_of)(R *p);                                     \
+                                                                           \
 FFTW_EXTERN X(plan) X(plan_dft_c2r)(int rank, const int *n,                \
                         C *in, R *out, unsigned flags);                    \
 FFTW_EXTERN X(plan) X(plan_dft_r2c)(int rank, const int *n,                \
@@ -29,6 +48,7 @@ FFTW_EXTERN X(plan) X(plan_dft_r2c)(int rank, const int *n,                \
 #define FFTW_CONCAT(prefix, name) prefix ## name
 #define FFTW_MANGLE_DOUBLE(name) FFTW_CONCAT(fftw_, name)
 #define FFTW_ESTIMATE (1U << 6)
+#define FFTW_PRESERVE_INPUT (1U << 4)
 
 FFTW_DEFINE_API(FFTW_MANGLE_DOUBLE, double, fftw_complex)
 }
@@ -39,6 +59,19 @@ FFTW_DEFINE_API(FFTW_MANGLE_DOUBLE, double, fftw_complex)
 #endif
 #endif
 
+#ifdef HAVE_FFTW
+namespace {
+  // FFTW plans may only be executed on other arrays (fftw_execute_dft_c2r,
+  // fftw_execute_r2r) that have the SIMD alignment of the arrays they were
+  // made for.
+  inline bool SameAlignment(const void* a, const void* b)
+  {
+    return fftw_alignment_of(static_cast<double*>(const_cast<void*>(a))) ==
+           fftw_alignment_of(static_cast<double*>(const_cast<void*>(b)));
+  }
+}
+#endif
+
 //______________________________________________________________________________
 // This class implements the fftw3 and takes the data from an TWaveform and
 // FFT's it into a TWaveformFT.  Given that the data is real, one can take
@@ -57,6 +90,27 @@ FFTW_DEFINE_API(FFTW_MANGLE_DOUBLE, double, fftw_complex)
 // length/2 + 1.)  A reference/pointer can be saved as the follwoing:
 //
 //   TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(2048);
+//
+// Every length gets its own plans and scratch waveforms, which are kept
+// until exit.  Long-running programs seeing many lengths can bound this
+// with SetCacheCapacity(n): only the n most recently requested lengths are
+// then kept, so that a saved reference is only valid until GetFFT is called
+// with another length.  GetCacheStatistics() gives the hits, misses,
+// evictions, the time spent making plans and the memory held.
+//
+// The cache is not locked, the FFTW planner is not thread-safe and every
+// FFT transforms through its own scratch waveforms, so GetFFT and the
+// transforms must all be called from one thread.
+//
+// With the threaded FFTW library, transforms of at least
+// GetThreadingThreshold() samples (2^18 by default) are split over
+// SetNumberOfThreads(n) threads, which speeds up the FFT of long continuous
+// traces.  Shorter transforms are always single-threaded.
+//
+// Without FFTW, the transforms are done by the built-in engine TBuiltInFFT,
+// which can also be selected at run time with SetEngine(kBuiltInEngine),
+// e.g. to compare results or speed.  The planning and threading settings
+// only apply to FFTW.
 //      
 // CLASS IMPLEMENTATION:  TFastFourierTransformFFTW.cc
 //
@@ -70,33 +124,52 @@ FFTW_DEFINE_API(FFTW_MANGLE_DOUBLE, double, fftw_complex)
 
 
 TFastFourierTransformFFTW::FFTMap TFastFourierTransformFFTW::fMap;
+size_t TFastFourierTransformFFTW::fCacheCapacity = 0;
+unsigned long TFastFourierTransformFFTW::fCacheTick = 0;
+unsigned long TFastFourierTransformFFTW::fCacheHits = 0;
+unsigned long TFastFourierTransformFFTW::fCacheMisses = 0;
+unsigned long TFastFourierTransformFFTW::fCacheEvictions = 0;
+double TFastFourierTransformFFTW::fPlanningTime = 0.;
+int TFastFourierTransformFFTW::fNumberOfThreads = 1;
+size_t TFastFourierTransformFFTW::fThreadingThreshold = 1 << 18;
+#ifdef HAVE_FFTW
+TFastFourierTransformFFTW::EEngine TFastFourierTransformFFTW::fEngine = kFFTWEngine;
+#else
+TFastFourierTransformFFTW::EEngine TFastFourierTransformFFTW::fEngine = kBuiltInEngine;
+#endif
+
 TFastFourierTransformFFTW::TFastFourierTransformFFTW(size_t length) : 
   fTheForwardPlan(NULL),
   fTheInversePlan(NULL),
-  fLength(length)
+  fBuiltIn(NULL),
+  fLength(length),
+  fLastUse(0),
+  fCounters(TWaveformProfiler::GetFFTCounters(length))
 {
+  for (int i=0;i<kNumRealTransforms;i++) fTheRealPlans[i] = NULL;
 }
 
 //______________________________________________________________________________
 TFastFourierTransformFFTW::TFastFourierTransformFFTW(const TFastFourierTransformFFTW& other) : 
   fTheForwardPlan(NULL),
   fTheInversePlan(NULL),
-  fLength(other.fLength)
+  fBuiltIn(NULL),
+  fLength(other.fLength),
+  fLastUse(other.fLastUse),
+  fCounters(other.fCounters)
 {
   // Copy constructor.  Do not copy the plans of the other FFT
+  for (int i=0;i<kNumRealTransforms;i++) fTheRealPlans[i] = NULL;
 }
 
 //______________________________________________________________________________
 TFastFourierTransformFFTW& 
   TFastFourierTransformFFTW::operator=(const TFastFourierTransformFFTW& other) 
 {
-#ifdef HAVE_FFTW
-  if (fTheForwardPlan != NULL) fftw_destroy_plan((fftw_plan)fTheForwardPlan);
-  if (fTheInversePlan != NULL) fftw_destroy_plan((fftw_plan)fTheInversePlan);
-#endif
-  fTheForwardPlan = NULL;
-  fTheInversePlan = NULL;
+  DestroyPlans();
   fLength = other.fLength;
+  fLastUse = other.fLastUse;
+  fCounters = other.fCounters;
   return *this;
 }
 
@@ -105,66 +178,365 @@ TFastFourierTransformFFTW& TFastFourierTransformFFTW::GetFFT( size_t length )
 {
   FFTMap::iterator iter;
   if ( (iter = fMap.find(length)) == fMap.end() ) {
+      fCacheMisses++;
       iter = fMap.insert(std::make_pair(length,TFastFourierTransformFFTW(length))).first;
+      if ( fCacheCapacity > 0 ) {
+        while ( fMap.size() > fCacheCapacity ) EvictLeastRecentlyUsed(length);
+      }
+  } else {
+      fCacheHits++;
   }
+  iter->second.fLastUse = ++fCacheTick;
   return iter->second;
 }
 
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::EvictLeastRecentlyUsed( size_t keepLength )
+{
+  // Destroy the least recently requested FFT other than keepLength.  A
+  // linear search is fine, the cache holds a few lengths. 
+  FFTMap::iterator oldest = fMap.end();
+  for ( FFTMap::iterator iter = fMap.begin(); iter != fMap.end(); iter++ ) {
+    if ( iter->first == keepLength ) continue;
+    if ( oldest == fMap.end() || iter->second.fLastUse < oldest->second.fLastUse ) {
+      oldest = iter;
+    }
+  }
+  if ( oldest == fMap.end() ) return;
+  fMap.erase(oldest);
+  fCacheEvictions++;
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::SetCacheCapacity( size_t maxLengths )
+{
+  // Keep at most maxLengths FFTs (0: no limit).  If more are cached, the
+  // least recently used ones are destroyed now.
+  fCacheCapacity = maxLengths;
+  if ( fCacheCapacity == 0 ) return;
+  while ( fMap.size() > fCacheCapacity ) EvictLeastRecentlyUsed((size_t)-1);
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::ClearCache()
+{
+  fMap.clear();
+}
+
+//______________________________________________________________________________
+TFastFourierTransformFFTW::CacheStatistics TFastFourierTransformFFTW::GetCacheStatistics()
+{
+  CacheStatistics stats;
+  stats.fHits = fCacheHits;
+  stats.fMisses = fCacheMisses;
+  stats.fEvictions = fCacheEvictions;
+  stats.fPlanningTime = fPlanningTime;
+  stats.fEntries = fMap.size();
+  stats.fPlans = 0;
+  stats.fBytes = 0;
+  for ( FFTMap::const_iterator iter = fMap.begin(); iter != fMap.end(); iter++ ) {
+    stats.fPlans += iter->second.GetNumberOfPlans();
+    stats.fBytes += iter->second.GetScratchBytes();
+  }
+  return stats;
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::ResetCacheStatistics()
+{
+  // Reset the counters and planning time (not the cache itself).
+  fCacheHits = 0;
+  fCacheMisses = 0;
+  fCacheEvictions = 0;
+  fPlanningTime = 0.;
+}
+
+//______________________________________________________________________________
+size_t TFastFourierTransformFFTW::GetNumberOfPlans() const
+{
+  size_t plans = (fTheForwardPlan != NULL) + (fTheInversePlan != NULL);
+  for (int i=0;i<kNumRealTransforms;i++) plans += (fTheRealPlans[i] != NULL);
+  return plans + (fBuiltIn != NULL);
+}
+
+//______________________________________________________________________________
+size_t TFastFourierTransformFFTW::GetScratchBytes() const
+{
+  // Memory of the scratch waveforms.  The plans themselves are held by
+  // FFTW, which does not report their size.
+  size_t bytes = (fWF.GetLength() + fRealOut.GetLength())*sizeof(double) + 
+                 fFT.GetLength()*sizeof(std::complex<double>);
+  if ( fBuiltIn != NULL ) bytes += fBuiltIn->GetScratchBytes();
+  return bytes;
+}
+
 //______________________________________________________________________________
 TFastFourierTransformFFTW::~TFastFourierTransformFFTW()
 {
+  DestroyPlans();
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::DestroyPlans()
+{
+  // Destroy all plans, they are remade when next needed.
 #ifdef HAVE_FFTW
   if (fTheForwardPlan != NULL) fftw_destroy_plan((fftw_plan)fTheForwardPlan);
   if (fTheInversePlan != NULL) fftw_destroy_plan((fftw_plan)fTheInversePlan);
+  for (int i=0;i<kNumRealTransforms;i++) {
+    if (fTheRealPlans[i] != NULL) fftw_destroy_plan((fftw_plan)fTheRealPlans[i]);
+  }
+#endif
+  fTheForwardPlan = NULL;
+  fTheInversePlan = NULL;
+  for (int i=0;i<kNumRealTransforms;i++) fTheRealPlans[i] = NULL;
+  delete fBuiltIn;
+  fBuiltIn = NULL;
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::SetEngine( EEngine engine )
+{
+  // Select the engine of all FFTs.  Without FFTW only the built-in engine
+  // is available.
+#ifndef HAVE_FFTW
+  if ( engine == kFFTWEngine ) {
+    std::cerr << "Compiled without FFTW3" << std::endl;
+    return;
+  }
+#endif
+  fEngine = engine;
+}
+
+//______________________________________________________________________________
+TBuiltInFFT& TFastFourierTransformFFTW::GetBuiltIn()
+{
+  // The built-in engine of this length, made on first use (like a plan).
+  if ( fBuiltIn == NULL ) {
+    TStopwatch timer;
+    fBuiltIn = new TBuiltInFFT(fLength);
+    RecordPlan(timer.RealTime());
+  }
+  return *fBuiltIn;
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::RecordPlan( double seconds )
+{
+  // Account a plan (or built-in engine) made in seconds, for the cache
+  // statistics and TWaveformProfiler.
+  fPlanningTime += seconds;
+  if ( TWaveformProfiler::IsEnabled() ) {
+    TWaveformProfiler::AddPlan(fCounters, static_cast<ULong64_t>(1e9*seconds));
+  }
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::SetNumberOfThreads( int nThreads )
+{
+  // Number of threads used by the transforms of at least
+  // GetThreadingThreshold() samples, for all FFTs of the library.  Needs
+  // the threaded FFTW library (HAVE_FFTW_THREADS), otherwise the transforms
+  // stay single-threaded.  Cached plans affected by the change are remade.
+  if ( nThreads < 1 ) nThreads = 1;
+#ifndef HAVE_FFTW_THREADS
+  if ( nThreads > 1 ) std::cerr << "Compiled without threaded FFTW3" << std::endl;
+#endif
+  if ( nThreads == fNumberOfThreads ) return;
+  fNumberOfThreads = nThreads;
+  ReplanAbove(fThreadingThreshold);
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::SetThreadingThreshold( size_t length )
+{
+  // Transforms shorter than length are always planned single-threaded, so
+  // that many short transforms (e.g. TWaveformBatch) are not slowed down by
+  // the thread overhead.  Cached plans affected by the change are remade.
+  size_t lowest = (length < fThreadingThreshold) ? length : fThreadingThreshold;
+  fThreadingThreshold = length;
+  if ( fNumberOfThreads > 1 ) ReplanAbove(lowest);
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::ReplanAbove( size_t length )
+{
+  // Drop the plans of all cached FFTs of at least length samples, keeping
+  // the FFTs themselves so that references from GetFFT stay valid.
+  for ( FFTMap::iterator iter = fMap.lower_bound(length); iter != fMap.end(); iter++ ) {
+    iter->second.DestroyPlans();
+  }
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::SetPlannerThreads() const
+{
+  // Called before making a plan: select the number of threads of the plan.
+#ifdef HAVE_FFTW_THREADS
+  static bool initialized = false;
+  if ( !initialized ) initialized = (fftw_init_threads() != 0);
+  if ( initialized ) {
+    fftw_plan_with_nthreads( (fLength >= fThreadingThreshold) ? fNumberOfThreads : 1 );
+  }
 #endif
 }
 
 //______________________________________________________________________________
-#ifdef HAVE_FFTW
 void TFastFourierTransformFFTW::PerformFFT( const TDoubleWaveform& aWaveform, 
                                             TWaveformFT& aWaveformFT )
-#else
-void TFastFourierTransformFFTW::PerformFFT( const TDoubleWaveform&, 
-                                            TWaveformFT& )
-#endif
 {
   // Performs an Real-to-complex FFT on aWaveform, returning the data in
   // aWaveformFT.  aWaveformFT will be resized to be aWaveform.GetLength()/2 +
   // 1.  That is, since a DFT of real data generates hermitian data, only half
   // of this data must be stored.  For more details see http://www.fftw.org
 
-#ifdef HAVE_FFTW
   if ( fLength != aWaveform.GetLength() ) {
-    std::cerr << "Called without correct length" << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Called without correct length");
     return;
   }
-  if ( fTheForwardPlan == NULL ) {
-    fWF.SetLength(fLength);
-    fFT.SetLength(fLength/2 + 1);
-    const int temp = fLength;
-    fTheForwardPlan = fftw_plan_dft_r2c( 1, &temp, 
-           &(fWF[0]), 
-           reinterpret_cast<fftw_complex*>(&(fFT[0])), 
-           FFTW_ESTIMATE );
+  if ( fEngine == kBuiltInEngine ) {
+    TBuiltInFFT& engine = GetBuiltIn();
+    TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
+    aWaveformFT.SetLength(fLength/2 + 1);
+    engine.PerformFFT(aWaveform.GetData(), aWaveformFT.GetData());
+    aWaveformFT.SetSamplingFreq(aWaveform.GetSamplingFreq());
+    return;
   }
+#ifdef HAVE_FFTW
+  if ( fTheForwardPlan == NULL ) MakeForwardPlan();
+  TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
   fWF = aWaveform;
   fftw_execute( (fftw_plan)fTheForwardPlan );
   aWaveformFT = fFT;
   aWaveformFT.SetSamplingFreq(aWaveform.GetSamplingFreq());
-#else
-  std::cerr << "Compiled without FFTW3" << std::endl;
 #endif
   
 }
 
 //______________________________________________________________________________
+void TFastFourierTransformFFTW::MakeForwardPlan()
+{
+  // Plan the forward transform from fWF to fFT.
+#ifdef HAVE_FFTW
+  fWF.SetLength(fLength);
+  fFT.SetLength(fLength/2 + 1);
+  const int temp = fLength;
+  SetPlannerThreads();
+  TStopwatch timer;
+  fTheForwardPlan = fftw_plan_dft_r2c( 1, &temp, 
+         &(fWF[0]), 
+         reinterpret_cast<fftw_complex*>(&(fFT[0])), 
+         FFTW_ESTIMATE );
+  RecordPlan(timer.RealTime());
+#endif
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::MakeInversePlan()
+{
+  // Plan the inverse transform from fFT to fWF.
 #ifdef HAVE_FFTW
-void TFastFourierTransformFFTW::PerformInverseFFT( TDoubleWaveform& aWaveform,  
-                                                   const TWaveformFT& aWaveformFT )
-#else
-void TFastFourierTransformFFTW::PerformInverseFFT( TDoubleWaveform&,  
-                                                   const TWaveformFT& )
+  fWF.SetLength(fLength);
+  fFT.SetLength(fLength/2 + 1);
+  const int temp = fLength;
+  SetPlannerThreads();
+  TStopwatch timer;
+  fTheInversePlan = fftw_plan_dft_c2r( 1, &temp, 
+         reinterpret_cast<fftw_complex*>(&(fFT[0])), 
+         &(fWF[0]), 
+         FFTW_ESTIMATE );
+  RecordPlan(timer.RealTime());
+#endif
+}
+
+//______________________________________________________________________________
+size_t TFastFourierTransformFFTW::GetFastLength( size_t length )
+{
+  // Smallest length >= length of the form 2^a 3^b 5^c 7^d, for which FFTW
+  // is fast.  Lengths with large prime factors can be many times slower.
+  if ( length <= 1 ) return 1;
+  size_t best = (size_t)-1;
+  for ( size_t p7 = 1; p7 < best; p7 *= 7 ) {
+    for ( size_t p5 = p7; p5 < best; p5 *= 5 ) {
+      for ( size_t p3 = p5; p3 < best; p3 *= 3 ) {
+        size_t p2 = p3;
+        while ( p2 < length ) p2 *= 2;
+        if ( p2 < best ) best = p2;
+        if ( p3 >= length ) break;
+      }
+      if ( p5 >= length ) break;
+    }
+    if ( p7 >= length ) break;
+  }
+  return best;
+}
+
+//______________________________________________________________________________
+TFastFourierTransformFFTW& TFastFourierTransformFFTW::GetFFT( size_t length, EPadding padding )
+{
+  // With kPadToFastLength, the FFT of GetFastLength(length), to be used with
+  // PerformPaddedFFT.
+  return GetFFT( (padding == kPadToFastLength) ? GetFastLength(length) : length );
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::PerformPaddedFFT( const TDoubleWaveform& aWaveform, 
+                                                  TWaveformFT& aWaveformFT )
+{
+  // As PerformFFT, but aWaveform may be shorter than the length of this FFT
+  // and is then padded with zeros (in the copy to the internal buffer, so
+  // there is no extra pass).  The sampling frequency of aWaveformFT is that
+  // of aWaveform, bin k is at frequency k*fs/GetLength(), see GetFrequency.
+
+  const size_t n = aWaveform.GetLength();
+  if ( n > fLength ) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Called with a waveform longer than the FFT");
+    return;
+  }
+  if ( fEngine == kFFTWEngine && fTheForwardPlan == NULL ) MakeForwardPlan();
+  TBuiltInFFT* engine = (fEngine == kBuiltInEngine) ? &GetBuiltIn() : NULL;
+  TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
+  fWF.SetLength(fLength);
+  const double* in = aWaveform.GetData();
+  double* out = fWF.GetData();
+  for (size_t i=0;i<n;i++) out[i] = in[i];
+  for (size_t i=n;i<fLength;i++) out[i] = 0.;
+  if ( engine != NULL ) {
+    aWaveformFT.SetLength(fLength/2 + 1);
+    engine->PerformFFT(fWF.GetData(), aWaveformFT.GetData());
+    aWaveformFT.SetSamplingFreq(aWaveform.GetSamplingFreq());
+    return;
+  }
+#ifdef HAVE_FFTW
+  fftw_execute( (fftw_plan)fTheForwardPlan );
+  aWaveformFT = fFT;
+  aWaveformFT.SetSamplingFreq(aWaveform.GetSamplingFreq());
 #endif
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::PerformPaddedInverseFFT( TDoubleWaveform& aWaveform, 
+                                                         TWaveformFT& aWaveformFT,
+                                                         size_t length, bool normalize )
+{
+  // Inverse of PerformPaddedFFT: the inverse transform of aWaveformFT
+  // (destroyed, as in PerformInverseFFTDestroyInput) truncated to its first
+  // length samples, e.g. the length of the waveform before padding. 
+  if ( length > fLength ) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Called with a length longer than the FFT");
+    return;
+  }
+  PerformInverseFFTDestroyInput(aWaveform, aWaveformFT, normalize);
+  if ( aWaveform.GetLength() == fLength ) aWaveform.SetLength(length);
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::PerformInverseFFT( TDoubleWaveform& aWaveform,  
+                                                   const TWaveformFT& aWaveformFT,
+                                                   bool normalize )
 {
   // Performs an Complex-to-Real inverse FFT on aWaveformFT, returning the data
   // in aWaveform.  aWaveform will be resized to be the logical size, n,  of
@@ -174,29 +546,158 @@ void TFastFourierTransformFFTW::PerformInverseFFT( TDoubleWaveform&,
   // values.  This is because the complex FT of real data is hermitian, so the
   // latter half of the data (n/2 -> n) would be redundant.  For more details
   // see http://www.fftw.org
+  //
+  // The transform is unnormalized (a forward and inverse transform multiply
+  // by n) unless normalize is set, in which case the division by n is done
+  // while copying out the result.  aWaveformFT is copied first since the
+  // transform overwrites its input, PerformInverseFFTDestroyInput avoids both
+  // copies.
 
-#ifdef HAVE_FFTW
   if ( fLength/2 + 1 != aWaveformFT.GetLength() ) {
-    std::cerr << "Called without correct length" << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Called without correct length");
     return;
   }
-  if ( fTheInversePlan == NULL ) {
-    fWF.SetLength(fLength);
-    fFT.SetLength(fLength/2 + 1);
-    const int temp = fLength;
-    fTheInversePlan = fftw_plan_dft_c2r( 1, &temp, 
-           reinterpret_cast<fftw_complex*>(&(fFT[0])), 
-           &(fWF[0]), 
-           FFTW_ESTIMATE );
+  if ( fEngine == kBuiltInEngine ) {
+    TBuiltInFFT& engine = GetBuiltIn();
+    TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
+    aWaveform.SetLength(fLength);
+    engine.PerformInverseFFT(aWaveformFT.GetData(), aWaveform.GetData());
+    if (normalize) aWaveform *= 1./fLength;
+    aWaveform.SetSamplingFreq(aWaveformFT.GetSamplingFreq());
+    return;
   }
+#ifdef HAVE_FFTW
+  if ( fTheInversePlan == NULL ) MakeInversePlan();
 
+  TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
   fFT = aWaveformFT;
   fftw_execute( (fftw_plan)fTheInversePlan );
-  aWaveform = fWF;
+  if (normalize) {
+    aWaveform.SetLength(fLength);
+    const double scale = 1./fLength;
+    const double* in = fWF.GetData();
+    double* out = aWaveform.GetData();
+    for (size_t i=0;i<fLength;i++) out[i] = scale*in[i];
+    aWaveform.SetTOffset(fWF.GetTOffset());
+  } else {
+    aWaveform = fWF;
+  }
+  aWaveform.SetSamplingFreq(aWaveformFT.GetSamplingFreq());
+#endif
+
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::PerformInverseFFTDestroyInput( TDoubleWaveform& aWaveform,  
+                                                               TWaveformFT& aWaveformFT,
+                                                               bool normalize )
+{
+  // Same as PerformInverseFFT, but executed directly on the arrays of
+  // aWaveformFT and aWaveform, so no data is copied.  aWaveformFT is used
+  // as scratch space by FFTW and holds garbage afterwards.  With normalize,
+  // the spectrum is divided by n before the transform.  The plan is the
+  // aligned one of PerformInverseFFT, so this is only possible if the
+  // arrays have the same alignment as fFT and fWF (the usual case);
+  // otherwise PerformInverseFFT is called, which copies.
+
+  if ( fEngine == kBuiltInEngine ) {
+    // Does not need to destroy the input
+    PerformInverseFFT(aWaveform, aWaveformFT, normalize);
+    return;
+  }
+#ifdef HAVE_FFTW
+  if ( fLength/2 + 1 != aWaveformFT.GetLength() ) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Called without correct length");
+    return;
+  }
+  if ( fTheInversePlan == NULL ) MakeInversePlan();
+  aWaveform.SetLength(fLength);
+  if ( !SameAlignment(aWaveformFT.GetData(), fFT.GetData()) ||
+       !SameAlignment(aWaveform.GetData(), fWF.GetData()) ) {
+    PerformInverseFFT(aWaveform, aWaveformFT, normalize);
+    return;
+  }
+  TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
+  if (normalize) {
+    const double scale = 1./fLength;
+    double* spec = reinterpret_cast<double*>(aWaveformFT.GetData());
+    for (size_t i=0;i<2*aWaveformFT.GetLength();i++) spec[i] *= scale;
+  }
+  fftw_execute_dft_c2r( (fftw_plan)fTheInversePlan,
+           reinterpret_cast<fftw_complex*>(aWaveformFT.GetData()),
+           aWaveform.GetData() );
+  aWaveform.SetTOffset(fWF.GetTOffset());
   aWaveform.SetSamplingFreq(aWaveformFT.GetSamplingFreq());
-#else
-  std::cerr << "Compiled without FFTW3" << std::endl;
 #endif
 
 }
 
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::PerformRealTransform( const TDoubleWaveform& aWaveform,
+                                                      TDoubleWaveform& aResult,
+                                                      ERealTransform kind )
+{
+  // Performs a real-to-real transform of aWaveform into aResult (which gets
+  // the same length and sampling frequency).  The plans are made once per
+  // kind, from fWF to fRealOut, and executed directly on the arrays of the
+  // waveforms when they have the same alignment, so usually no data is
+  // copied.  The input is preserved.
+  // For definitions see http://www.fftw.org/fftw3_doc/1d-Real_002deven-DFTs-_0028DCTs_0029.html
+
+  if ( fLength != aWaveform.GetLength() || kind >= kNumRealTransforms ) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Called without correct length");
+    return;
+  }
+  if ( fEngine == kBuiltInEngine ) {
+    TBuiltInFFT& engine = GetBuiltIn();
+    TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
+    if ( &aResult != &aWaveform ) aResult.MakeSimilarTo(aWaveform);
+    engine.PerformRealTransform(aWaveform.GetData(), aResult.GetData(), 
+                                      (TBuiltInFFT::ERealTransform)kind);
+    return;
+  }
+#ifdef HAVE_FFTW
+  if ( fTheRealPlans[kind] == NULL ) {
+    static const fftw_r2r_kind kinds[kNumRealTransforms] = 
+      { FFTW_REDFT10, FFTW_REDFT01, FFTW_RODFT10, FFTW_RODFT01 };
+    fWF.SetLength(fLength);
+    fRealOut.SetLength(fLength);
+    const int temp = fLength;
+    SetPlannerThreads();
+    TStopwatch timer;
+    fTheRealPlans[kind] = fftw_plan_r2r( 1, &temp, &(fWF[0]), &(fRealOut[0]), &kinds[kind], 
+           FFTW_ESTIMATE | FFTW_PRESERVE_INPUT );
+    RecordPlan(timer.RealTime());
+  }
+  TWaveformProfiler::ScopedTimer timer(fCounters, fLength);
+  const double* in = aWaveform.GetData();
+  if ( &aResult == &aWaveform || !SameAlignment(in, fWF.GetData()) ) {
+    // In place or misaligned, go through the scratch waveform
+    fWF = aWaveform;
+    in = fWF.GetData();
+  }
+  if ( &aResult != &aWaveform ) aResult.MakeSimilarTo(aWaveform);
+  if ( SameAlignment(aResult.GetData(), fRealOut.GetData()) ) {
+    fftw_execute_r2r( (fftw_plan)fTheRealPlans[kind], 
+             const_cast<double*>(in), aResult.GetData() );
+  } else {
+    fftw_execute_r2r( (fftw_plan)fTheRealPlans[kind], 
+             const_cast<double*>(in), fRealOut.GetData() );
+    std::copy(fRealOut.begin(), fRealOut.end(), aResult.begin());
+  }
+#endif
+}
+
+//______________________________________________________________________________
+void TFastFourierTransformFFTW::PerformInverseDCT( const TDoubleWaveform& aResult, 
+                                                   TDoubleWaveform& aWaveform, 
+                                                   bool normalize )
+{
+  // DCT-III of aResult, i.e. the inverse of PerformDCT up to a factor
+  // 2*length which is removed with normalize.
+  PerformRealTransform(aResult, aWaveform, kDCTIII);
+  if (normalize && aWaveform.GetLength() == fLength) aWaveform *= 1./(2*fLength);
+}
@@ -20,8 +20,11 @@
 #define _WAVE_TFastFourierTransformFFTW_HH
 
 #include "TTemplWaveform.hh"
+#include "TWaveformProfiler.hh"
 #include <map>
 
+class TBuiltInFFT;
+
 class TFastFourierTransformFFTW 
 {
   public:
@@ -36,17 +39,112 @@ class TFastFourierTransformFFTW
     virtual void PerformFFT( const TDoubleWaveform& aWaveform, TWaveformFT& aWaveformFT );
 
     // Perform an inverse Fourier Transform on the data in aWaveformFT, storing 
-    // it in  aWaveformFT. 
-    virtual void PerformInverseFFT( TDoubleWaveform& aWaveform,  const TWaveformFT& aWaveformFT );
+    // it in  aWaveformFT.  With normalize, the result is divided by the
+    // length (in the same pass that copies it out).
+    virtual void PerformInverseFFT( TDoubleWaveform& aWaveform,  const TWaveformFT& aWaveformFT,
+                                    bool normalize = false );
+
+    // As PerformInverseFFT, but transforms directly from aWaveformFT into
+    // aWaveform without any copies.  The contents of aWaveformFT are
+    // destroyed.
+    virtual void PerformInverseFFTDestroyInput( TDoubleWaveform& aWaveform, TWaveformFT& aWaveformFT,
+                                                bool normalize = false );
     static TFastFourierTransformFFTW& GetFFT(size_t length); 
+
+    // Opt-in zero padding to lengths FFTW handles fast (2^a 3^b 5^c 7^d):
+    // GetFFT(n, kPadToFastLength) returns the FFT of GetFastLength(n), and
+    // PerformPaddedFFT/PerformPaddedInverseFFT pad and truncate.
+    enum EPadding { kExactLength, kPadToFastLength };
+    static TFastFourierTransformFFTW& GetFFT(size_t length, EPadding padding); 
+    static size_t GetFastLength(size_t length);
+    virtual void PerformPaddedFFT( const TDoubleWaveform& aWaveform, TWaveformFT& aWaveformFT );
+    virtual void PerformPaddedInverseFFT( TDoubleWaveform& aWaveform, TWaveformFT& aWaveformFT,
+                                          size_t length, bool normalize = false );
+    size_t GetLength() const { return fLength; }
+    // Frequency of bin k of a transform made by this FFT.
+    double GetFrequency(size_t k, double samplingFreq) const 
+      { return k*samplingFreq/fLength; }
+
+    // GetFFT keeps one FFT (plans and scratch waveforms) per length.  The
+    // cache is unbounded by default; with a capacity the least recently
+    // requested lengths are destroyed when a new length comes in, and a
+    // reference returned by GetFFT is then only valid until GetFFT is
+    // called for another length.  Transforms and plans per length are
+    // counted by TWaveformProfiler.
+    struct CacheStatistics {
+      unsigned long fHits;
+      unsigned long fMisses;
+      unsigned long fEvictions;
+      double        fPlanningTime;  // seconds (real time) spent making plans
+      size_t        fEntries;
+      size_t        fPlans;
+      size_t        fBytes;         // scratch memory held by the cached FFTs
+    };
+    // Maximum number of lengths kept, 0 means no limit.
+    static void SetCacheCapacity(size_t maxLengths);
+    static size_t GetCacheCapacity() { return fCacheCapacity; }
+    // Destroy all cached FFTs, invalidating all references from GetFFT.
+    static void ClearCache();
+    static CacheStatistics GetCacheStatistics();
+    static void ResetCacheStatistics();
+
+    // Library-wide number of threads for transforms of at least
+    // GetThreadingThreshold() samples (requires the threaded FFTW library).
+    static void SetNumberOfThreads(int nThreads);
+    static int GetNumberOfThreads() { return fNumberOfThreads; }
+    static void SetThreadingThreshold(size_t length);
+    static size_t GetThreadingThreshold() { return fThreadingThreshold; }
+
+    // Engine doing the transforms: FFTW (default when available) or the
+    // built-in TBuiltInFFT.  Results agree to rounding.
+    enum EEngine { kFFTWEngine, kBuiltInEngine };
+    static void SetEngine(EEngine engine);
+    static EEngine GetEngine() { return fEngine; }
+
+    // Real-to-real transforms (FFTW's REDFT10, REDFT01, RODFT10, RODFT01),
+    // unnormalized: a type II followed by the type III transform multiplies
+    // by 2*length.
+    enum ERealTransform { kDCTII, kDCTIII, kDSTII, kDSTIII, kNumRealTransforms };
+    virtual void PerformRealTransform( const TDoubleWaveform& aWaveform, TDoubleWaveform& aResult,
+                                       ERealTransform kind );
+    void PerformDCT( const TDoubleWaveform& aWaveform, TDoubleWaveform& aResult )
+      { PerformRealTransform(aWaveform, aResult, kDCTII); }
+    // Inverse of PerformDCT, with normalize the 1/(2*length) is included.
+    void PerformInverseDCT( const TDoubleWaveform& aResult, TDoubleWaveform& aWaveform, 
+                            bool normalize = false );
     
   protected:
     void *fTheForwardPlan; 
     void *fTheInversePlan; 
+    void *fTheRealPlans[kNumRealTransforms]; // from fWF to fRealOut
+    TBuiltInFFT *fBuiltIn;     //! built-in engine, made on first use
     TWaveformFT fFT;
     TDoubleWaveform fWF;
+    TDoubleWaveform fRealOut;  // output the real-to-real plans are made for
     size_t fLength;
+    unsigned long fLastUse;   // value of fCacheTick when last requested
+    TWaveformProfiler::CounterId fCounters; //! of this length
+    void MakeForwardPlan();
+    void MakeInversePlan();
+    void DestroyPlans();
+    TBuiltInFFT& GetBuiltIn();
+    void SetPlannerThreads() const;
+    void RecordPlan(double seconds);
+    size_t GetNumberOfPlans() const;
+    size_t GetScratchBytes() const;
+
     static FFTMap fMap;
+    static size_t fCacheCapacity;
+    static unsigned long fCacheTick;
+    static unsigned long fCacheHits;
+    static unsigned long fCacheMisses;
+    static unsigned long fCacheEvictions;
+    static double fPlanningTime;
+    static int fNumberOfThreads;
+    static size_t fThreadingThreshold;
+    static EEngine fEngine;
+    static void ReplanAbove(size_t length);
+    static void EvictLeastRecentlyUsed(size_t keepLength);
     TFastFourierTransformFFTW(size_t length);
     TFastFourierTransformFFTW(const TFastFourierTransformFFTW&);
     TFastFourierTransformFFTW& operator=(const TFastFourierTransformFFTW&);
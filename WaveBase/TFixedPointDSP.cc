@@ -0,0 +1,290 @@
+#include "TFixedPointDSP.hh"
+#include "TMath.h"
+#include <vector>
+//______________________________________________________________________________
+//
+//  TFixedPointDSP
+//
+//  Integer processing of raw ADC waveforms, reproducing firmware bit by
+//  bit.  No operation goes through double: samples are widened to the
+//  Wide type of TFixedPointTraits (16 -> 32 bit, 32 -> 64 bit), combined
+//  there and saturated back.  The loops have no branches (the saturation
+//  is a min/max), so that on short waveforms the compiler uses 16-bit SIMD
+//  lanes, four times as many as for double.
+//
+//  For example, a trapezoid on a TShortWaveform with 10 ns sampling,
+//  2 us rise, 1 us flat top and 50 us decay:
+//
+//    TFixedPointDSP::SubtractBaseline(wf, 7);      // 128 samples
+//    Long64_t M = TFixedPointDSP::GetPoleZeroMultiplier(50*CLHEP::microsecond,
+//                                                       wf.GetSamplingFreq(), 8);
+//    TIntWaveform trap;
+//    TFixedPointDSP::Trapezoid(wf, trap, 200, 100, M, 8, 16);
+//
+//  gives an output proportional to the pulse height, with a gain of
+//  200*(M+1)/2^16.
+//______________________________________________________________________________
+
+namespace {
+  template<typename _Wide>
+  _Wide RoundShift(_Wide x, UInt_t shift)
+  {
+    // Rounding arithmetic right shift, round(x/2^shift) with halves rounded
+    // up.  Written without x + 2^(shift-1), which can overflow, and valid
+    // for any shift: from the width of _Wide on, the result is 0.
+    if (shift == 0) return x;
+    if (shift >= 8*sizeof(_Wide)) return 0;
+    return (x >> shift) + ((x >> (shift - 1)) & 1);
+  }
+
+  template<typename _Out>
+  void NarrowImpl(const TIntWaveform& in, TTemplWaveform<_Out>& out, UInt_t shift)
+  {
+    out.MakeSimilarTo(in);
+    const Int_t* x = in.GetData();
+    _Out* y = out.GetData();
+    const size_t n = in.GetLength();
+    for (size_t i=0;i<n;i++) {
+      Long64_t v = RoundShift<Long64_t>(x[i], shift);
+      y[i] = TFixedPointDSP::Saturate<_Out>((Int_t)TFixedPointDSP::Saturate<Int_t>(v));
+    }
+  }
+
+  template<typename _In>
+  void WidenImpl(const TTemplWaveform<_In>& in, TIntWaveform& out)
+  {
+    out.MakeSimilarTo(in);
+    const _In* x = in.GetData();
+    Int_t* y = out.GetData();
+    const size_t n = in.GetLength();
+    for (size_t i=0;i<n;i++) y[i] = x[i];
+  }
+}
+
+//______________________________________________________________________________
+void TFixedPointDSP::Widen(const TShortWaveform& in, TIntWaveform& out)
+{
+  WidenImpl(in, out);
+}
+
+//______________________________________________________________________________
+void TFixedPointDSP::Widen(const TUShortWaveform& in, TIntWaveform& out)
+{
+  WidenImpl(in, out);
+}
+
+//______________________________________________________________________________
+void TFixedPointDSP::Narrow(const TIntWaveform& in, TShortWaveform& out, UInt_t shift)
+{
+  NarrowImpl(in, out, shift);
+}
+
+//______________________________________________________________________________
+void TFixedPointDSP::Narrow(const TIntWaveform& in, TUShortWaveform& out, UInt_t shift)
+{
+  NarrowImpl(in, out, shift);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TFixedPointDSP::AddSaturate(TTemplWaveform<_Tp>& wf, 
+                                 typename TFixedPointTraits<_Tp>::Wide value)
+{
+  // value is first clamped to the span of _Tp, so that the sum cannot
+  // overflow Wide and still saturates the same way.
+  typedef TFixedPointTraits<_Tp> Tr;
+  typedef typename Tr::Wide Wide;
+  const Wide span = Tr::Max() - Tr::Min();
+  const Wide v = (value > span) ? span : ((value < -span) ? -span : value);
+  _Tp* x = wf.GetData();
+  const size_t n = wf.GetLength();
+  for (size_t i=0;i<n;i++) x[i] = Saturate<_Tp>(Wide(x[i]) + v);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TFixedPointDSP::AddSaturate(TTemplWaveform<_Tp>& wf, const TTemplWaveform<_Tp>& other)
+{
+  typedef typename TFixedPointTraits<_Tp>::Wide Wide;
+  if (wf.GetLength() != other.GetLength()) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Waveforms have different lengths");
+    return;
+  }
+  _Tp* x = wf.GetData();
+  const _Tp* y = other.GetData();
+  const size_t n = wf.GetLength();
+  for (size_t i=0;i<n;i++) x[i] = Saturate<_Tp>(Wide(x[i]) + Wide(y[i]));
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TFixedPointDSP::SubtractSaturate(TTemplWaveform<_Tp>& wf, const TTemplWaveform<_Tp>& other)
+{
+  typedef typename TFixedPointTraits<_Tp>::Wide Wide;
+  if (wf.GetLength() != other.GetLength()) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Waveforms have different lengths");
+    return;
+  }
+  _Tp* x = wf.GetData();
+  const _Tp* y = other.GetData();
+  const size_t n = wf.GetLength();
+  for (size_t i=0;i<n;i++) x[i] = Saturate<_Tp>(Wide(x[i]) - Wide(y[i]));
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TFixedPointDSP::ScaleSaturate(TTemplWaveform<_Tp>& wf, Int_t multiplier, UInt_t shift)
+{
+  // The product is formed in 64 bit, so any multiplier is exact, and any
+  // shift is valid (RoundShift).
+  _Tp* x = wf.GetData();
+  const size_t n = wf.GetLength();
+  for (size_t i=0;i<n;i++) {
+    Long64_t v = RoundShift<Long64_t>(Long64_t(x[i])*multiplier, shift);
+    x[i] = Saturate<_Tp>(Saturate<Int_t>(v));
+  }
+}
+
+//______________________________________________________________________________
+Int_t TFixedPointDSP::ToQFormat(double value, UInt_t fractionBits)
+{
+  // Nearest Q(fractionBits) representation of value, saturated to 32 bit.
+  double v = TMath::Floor(value*TMath::Power(2., (Double_t)fractionBits) + 0.5);
+  return Saturate<Int_t>((v > 2147483647.) ? 2147483647LL : 
+                         ((v < -2147483648.) ? -2147483647LL - 1 : (Long64_t)v));
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Long64_t TFixedPointDSP::Sum(const TTemplWaveform<_Tp>& wf, size_t beg, size_t end)
+{
+  size_t e = (end > wf.GetLength()) ? wf.GetLength() : end;
+  const _Tp* x = wf.GetData();
+  Long64_t sum = 0;
+  for (size_t i=beg;i<e;i++) sum += x[i];
+  return sum;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+typename TFixedPointTraits<_Tp>::Wide 
+TFixedPointDSP::GetBaseline(const TTemplWaveform<_Tp>& wf, UInt_t log2Samples)
+{
+  // If the waveform is shorter than 2^log2Samples, the largest power of 2
+  // that fits is used.
+  while (log2Samples > 0 && (size_t(1) << log2Samples) > wf.GetLength()) log2Samples--;
+  if (wf.GetLength() == 0) return 0;
+  return RoundShift<Long64_t>(Sum(wf, 0, size_t(1) << log2Samples), log2Samples);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+typename TFixedPointTraits<_Tp>::Wide 
+TFixedPointDSP::SubtractBaseline(TTemplWaveform<_Tp>& wf, UInt_t log2Samples)
+{
+  typename TFixedPointTraits<_Tp>::Wide baseline = GetBaseline(wf, log2Samples);
+  AddSaturate(wf, -baseline);
+  return baseline;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+size_t TFixedPointDSP::FindThreshold(const TTemplWaveform<_Tp>& wf, 
+                                     typename TFixedPointTraits<_Tp>::Wide threshold, 
+                                     size_t start)
+{
+  // Blocks of samples are tested without branches, see TPulseFinder.
+  const size_t kBlock = 32;
+  const size_t n = wf.GetLength();
+  const _Tp* x = wf.GetData();
+  size_t i = start;
+  while (i + kBlock <= n) {
+    int any = 0;
+    for (size_t j=0;j<kBlock;j++) any |= (x[i+j] > threshold);
+    if (any) break;
+    i += kBlock;
+  }
+  for (;i<n;i++) if (x[i] > threshold) return i;
+  return n;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TFixedPointDSP::Trapezoid(const TTemplWaveform<_Tp>& in, TIntWaveform& out,
+                               size_t rise, size_t flatTop, Long64_t pzMultiplier,
+                               UInt_t pzFractionBits, UInt_t outputShift)
+{
+  // Same recursion as TTrapezoidalFilter, with p scaled by 2^pzFractionBits:
+  //
+  //   d[n] = v[n] - v[n-k] - v[n-l] + v[n-k-l]
+  //   p[n] = p[n-1] + d[n]
+  //   s[n] = s[n-1] + p[n]*2^f + M*d[n]
+  //
+  // Samples before the start are equal to the first sample.
+  const size_t n = in.GetLength();
+  out.MakeSimilarTo(in);
+  if (n == 0) return;
+  if (pzFractionBits > 62) {
+    // 2^pzFractionBits must fit in Long64_t
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kInvalidParameter,
+      "Trapezoid: pzFractionBits must be at most 62");
+    out.Zero();
+    return;
+  }
+  if (rise == 0) rise = 1;
+  const size_t gap = rise + flatTop;
+  const _Tp* x = in.GetData();
+  Int_t* y = out.GetData();
+  // Shifts of 64 bits or more give 0, see RoundShift
+  const UInt_t shift = (outputShift < 64) ? pzFractionBits + outputShift : 64;
+  const Long64_t first = x[0];
+  const Long64_t scale = Long64_t(1) << pzFractionBits;
+  Long64_t p = 0, s = 0;
+  for (size_t i=0;i<n;i++) {
+    Long64_t vk  = (i >= rise) ? x[i - rise] : first;
+    Long64_t vl  = (i >= gap) ? x[i - gap] : first;
+    Long64_t vkl = (i >= rise + gap) ? x[i - rise - gap] : first;
+    Long64_t d = Long64_t(x[i]) - vk - vl + vkl;
+    p += d;
+    s += p*scale + pzMultiplier*d;
+    y[i] = Saturate<Int_t>(RoundShift<Long64_t>(s, shift));
+  }
+}
+
+//______________________________________________________________________________
+Long64_t TFixedPointDSP::GetPoleZeroMultiplier(double tau, double samplingFreq, 
+                                               UInt_t fractionBits)
+{
+  if (tau <= 0) return 0;
+  double M = 1./(TMath::Exp(1./(tau*samplingFreq)) - 1);
+  // Saturated like ToQFormat, the conversion of a double beyond the range
+  // of Long64_t is undefined.
+  double v = TMath::Floor(M*TMath::Power(2., (Double_t)fractionBits) + 0.5);
+  return (v >= 9223372036854775807.) ? 9223372036854775807LL : (Long64_t)v;
+}
+
+//______________________________________________________________________________
+// The following are necessary to ensure that the above functions are generated.
+#define TFIXEDPOINT_INSTANTIATE(atype)                                                     \
+template void TFixedPointDSP::AddSaturate(TTemplWaveform<atype>&,                          \
+                                          TFixedPointTraits<atype>::Wide);                 \
+template void TFixedPointDSP::AddSaturate(TTemplWaveform<atype>&,                          \
+                                          const TTemplWaveform<atype>&);                   \
+template void TFixedPointDSP::SubtractSaturate(TTemplWaveform<atype>&,                     \
+                                               const TTemplWaveform<atype>&);              \
+template void TFixedPointDSP::ScaleSaturate(TTemplWaveform<atype>&, Int_t, UInt_t);        \
+template Long64_t TFixedPointDSP::Sum(const TTemplWaveform<atype>&, size_t, size_t);       \
+template TFixedPointTraits<atype>::Wide                                                    \
+  TFixedPointDSP::GetBaseline(const TTemplWaveform<atype>&, UInt_t);                       \
+template TFixedPointTraits<atype>::Wide                                                    \
+  TFixedPointDSP::SubtractBaseline(TTemplWaveform<atype>&, UInt_t);                        \
+template size_t TFixedPointDSP::FindThreshold(const TTemplWaveform<atype>&,                \
+                                              TFixedPointTraits<atype>::Wide, size_t);     \
+template void TFixedPointDSP::Trapezoid(const TTemplWaveform<atype>&, TIntWaveform&,       \
+                                        size_t, size_t, Long64_t, UInt_t, UInt_t);
+
+TFIXEDPOINT_INSTANTIATE(Short_t)
+TFIXEDPOINT_INSTANTIATE(UShort_t)
+TFIXEDPOINT_INSTANTIATE(Int_t)
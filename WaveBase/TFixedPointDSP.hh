@@ -0,0 +1,114 @@
+/**
+ *
+ * CLASS DECLARATION:  TFixedPointDSP.hh
+ *
+ * DESCRIPTION:
+ *
+ * Integer and fixed-point processing of raw ADC waveforms: widening,
+ * saturating arithmetic, Q-format scaling and integer versions of the
+ * baseline, trigger and trapezoid filters.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TFixedPointDSP_hh
+#define WAVE_TFixedPointDSP_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+
+// Widening rules: intermediate results of operations on _Tp are computed in
+// Wide (exact for sums/differences of two samples and products with a
+// 16-bit coefficient), running sums in Acc.
+template<typename _Tp> struct TFixedPointTraits {};
+template<> struct TFixedPointTraits<Short_t> {
+  typedef Int_t    Wide;
+  typedef Long64_t Acc;
+  static Wide Min() { return -32768; }
+  static Wide Max() { return 32767; }
+};
+template<> struct TFixedPointTraits<UShort_t> {
+  typedef Int_t    Wide;
+  typedef Long64_t Acc;
+  static Wide Min() { return 0; }
+  static Wide Max() { return 65535; }
+};
+template<> struct TFixedPointTraits<Int_t> {
+  typedef Long64_t Wide;
+  typedef Long64_t Acc;
+  static Wide Min() { return -2147483647LL - 1; }
+  static Wide Max() { return 2147483647LL; }
+};
+
+class TFixedPointDSP
+{
+  public:
+    // All shifts are arithmetic (floor) shifts with rounding to nearest, as
+    // (x + 2^(shift-1)) >> shift, and all results saturate to the range
+    // of the output type.  The functions are instantiated for Short_t,
+    // UShort_t and Int_t waveforms.
+
+    template<typename _Tp>
+    static _Tp Saturate(typename TFixedPointTraits<_Tp>::Wide x)
+    {
+      typedef TFixedPointTraits<_Tp> Tr;
+      return static_cast<_Tp>((x < Tr::Min()) ? Tr::Min() : ((x > Tr::Max()) ? Tr::Max() : x));
+    }
+
+    // Exact conversion to 32 bit, and back with a rounding right shift.
+    static void Widen(const TShortWaveform& in, TIntWaveform& out);
+    static void Widen(const TUShortWaveform& in, TIntWaveform& out);
+    static void Narrow(const TIntWaveform& in, TShortWaveform& out, UInt_t shift = 0);
+    static void Narrow(const TIntWaveform& in, TUShortWaveform& out, UInt_t shift = 0);
+
+    // wf = sat(wf + value), wf = sat(wf +/- other)
+    template<typename _Tp>
+    static void AddSaturate(TTemplWaveform<_Tp>& wf, typename TFixedPointTraits<_Tp>::Wide value);
+    template<typename _Tp>
+    static void AddSaturate(TTemplWaveform<_Tp>& wf, const TTemplWaveform<_Tp>& other);
+    template<typename _Tp>
+    static void SubtractSaturate(TTemplWaveform<_Tp>& wf, const TTemplWaveform<_Tp>& other);
+    // Q-format scaling, wf = sat(round(wf*multiplier/2^shift)).  E.g. a gain
+    // of 0.75 in Q15 is multiplier 24576, shift 15.
+    template<typename _Tp>
+    static void ScaleSaturate(TTemplWaveform<_Tp>& wf, Int_t multiplier, UInt_t shift);
+    static Int_t ToQFormat(double value, UInt_t fractionBits);
+
+    template<typename _Tp>
+    static Long64_t Sum(const TTemplWaveform<_Tp>& wf, size_t beg = 0, size_t end = (size_t)-1);
+    // Baseline as the sum of the first 2^log2Samples samples shifted right,
+    // i.e. without a division, as in firmware.  SubtractBaseline also
+    // removes it (saturating) and returns it.
+    template<typename _Tp>
+    static typename TFixedPointTraits<_Tp>::Wide GetBaseline(const TTemplWaveform<_Tp>& wf, 
+                                                             UInt_t log2Samples);
+    template<typename _Tp>
+    static typename TFixedPointTraits<_Tp>::Wide SubtractBaseline(TTemplWaveform<_Tp>& wf, 
+                                                                  UInt_t log2Samples);
+    // First index >= start with wf > threshold, GetLength() if none.
+    template<typename _Tp>
+    static size_t FindThreshold(const TTemplWaveform<_Tp>& wf, 
+                                typename TFixedPointTraits<_Tp>::Wide threshold, 
+                                size_t start = 0);
+
+    // Integer trapezoid (see TTrapezoidalFilter) with rise and flat top in
+    // samples and pole-zero constant M given in Q(pzFractionBits), see
+    // GetPoleZeroMultiplier.  The accumulator s is 64 bit, the output is
+    // sat32(round(s/2^(pzFractionBits + outputShift))).  pzFractionBits
+    // must be at most 62.
+    template<typename _Tp>
+    static void Trapezoid(const TTemplWaveform<_Tp>& in, TIntWaveform& out,
+                          size_t rise, size_t flatTop, Long64_t pzMultiplier,
+                          UInt_t pzFractionBits, UInt_t outputShift = 0);
+    // M = 1/(exp(T/tau) - 1) in Q(fractionBits), 0 for tau <= 0.
+    static Long64_t GetPoleZeroMultiplier(double tau, double samplingFreq, 
+                                          UInt_t fractionBits);
+};
+
+#endif /* WAVE_TFixedPointDSP_hh */
@@ -0,0 +1,56 @@
+#include "THilbertTransform.hh"
+#include "TFastFourierTransformFFTW.hh"
+#include <cmath>
+
+//______________________________________________________________________________
+// THilbertTransform
+// 
+//   The analytic signal of x is x + iH(x), with H the Hilbert transform.
+//   H(x) is computed with the real FFTs of TFastFourierTransformFFTW: the
+//   half spectrum is multiplied by -i (DC and Nyquist bins set to zero)
+//   and transformed back, so no full complex array is built and the
+//   envelope costs one forward and one inverse half-size transform.  The
+//   normalization of the inverse FFT and the envelope or phase are then
+//   computed in a single pass.
+//
+//   The transform is circular, so expect edge effects where the waveform
+//   does not go smoothly from its last to its first sample.
+//
+
+void THilbertTransform::TransformInPlace(TDoubleWaveform& input) const
+{
+  const size_t N = input.GetLength();
+  if (N == 0) return;
+  TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(N);
+  fft.PerformFFT(input, fSpectrum);
+  const size_t nb = fSpectrum.GetLength();
+  if (nb != N/2 + 1) return;
+
+  // -i*(re + i im) = im - i re
+  double* X = reinterpret_cast<double*>(fSpectrum.GetData());
+  for (size_t k=1;k<nb;k++) {
+    double re = X[2*k];
+    X[2*k]   = X[2*k+1];
+    X[2*k+1] = -re;
+  }
+  X[0] = X[1] = 0.;
+  if (N % 2 == 0) X[2*(nb-1)] = X[2*(nb-1)+1] = 0.;
+  fft.PerformInverseFFTDestroyInput(fHilbert, fSpectrum);
+
+  const double norm = 1./N;
+  double* x = input.GetData();
+  const double* y = fHilbert.GetData();
+  switch (fOutput) {
+    case kHilbert:
+      for (size_t i=0;i<N;i++) x[i] = norm*y[i];
+      break;
+    case kPhase:
+      for (size_t i=0;i<N;i++) x[i] = std::atan2(norm*y[i], x[i]);
+      break;
+    default:
+      for (size_t i=0;i<N;i++) {
+        double h = norm*y[i];
+        x[i] = std::sqrt(x[i]*x[i] + h*h);
+      }
+  }
+}
@@ -0,0 +1,50 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  THilbertTransform.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Hilbert transform of a waveform and the envelope and phase of its
+ * analytic signal.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_THilbertTransform_hh
+#define WAVE_THilbertTransform_hh
+
+#ifndef WAVE_TVWaveformTransformer_hh
+#include "TVWaveformTransformer.hh" 
+#endif
+
+class THilbertTransform : public TVWaveformTransformer
+{
+  public:
+    enum EOutput { kEnvelope, kHilbert, kPhase };
+
+    THilbertTransform() : TVWaveformTransformer("THilbertTransform"), 
+      fOutput(kEnvelope) {}
+  
+    virtual bool IsInPlace() const { return true; }
+
+    // What the transformed waveform holds: the envelope |x + iH(x)|
+    // (default), the Hilbert transform H(x) or the instantaneous phase
+    // atan2(H(x), x) in radians.
+    void SetOutput(EOutput output) { fOutput = output; }
+    EOutput GetOutput() const { return fOutput; }
+    
+  protected:
+    virtual void TransformInPlace(TDoubleWaveform& input) const;
+
+    EOutput fOutput;
+
+    mutable TWaveformFT     fSpectrum;
+    mutable TDoubleWaveform fHilbert;
+};
+
+#endif /* WAVE_THilbertTransform_hh */
@@ -0,0 +1,250 @@
+#include "TIIRFilter.hh"
+#include "TMath.h"
+#include <algorithm>
+
+namespace {
+  template<size_t W>
+  void FilterLanes(const std::vector<TIIRFilter::Section>& sections, double* block,
+                   size_t width, size_t n, const double* base, double* state)
+  {
+    // Filter n rows of block, each holding one sample of every lane.  W is
+    // the number of lanes when known at compile time (0: use width), so
+    // that the loops over lanes map exactly on SIMD registers.  state holds
+    // z1 and z2 of each section for every lane and is updated.
+    const size_t nl = (W > 0) ? W : width;
+    const size_t ns = sections.size();
+    for (size_t i=0;i<n;i++) {
+      double* row = block + i*nl;
+      for (size_t l=0;l<nl;l++) row[l] -= base[l];
+      for (size_t k=0;k<ns;k++) {
+        const TIIRFilter::Section& s = sections[k];
+        double* z1 = state + 2*k*nl;
+        double* z2 = z1 + nl;
+        for (size_t l=0;l<nl;l++) {
+          double x = row[l];
+          double y = s.fB0*x + z1[l];
+          z1[l] = s.fB1*x - s.fA1*y + z2[l];
+          z2[l] = s.fB2*x - s.fA2*y;
+          row[l] = y;
+        }
+      }
+    }
+  }
+}
+
+//______________________________________________________________________________
+// TIIRFilter
+// 
+//   Generic recursive filter: a cascade of second-order sections (biquads),
+//   each evaluated in transposed direct form II,
+//
+//     y    = b0*x + z1
+//     z1   = b1*x - a1*y + z2
+//     z2   = b2*x - a2*y
+//
+//   All sections are evaluated sample by sample in a single pass over the
+//   waveform, including the (optional) baseline subtraction of the input.
+//   First-order sections simply have b2 = a2 = 0.
+//
+//   The usual shaping stages are available as designs, e.g. a CR-(RC)^4
+//   shaper with pole-zero correction of a 50 us preamplifier decay:
+//
+//     TIIRFilter shaper;
+//     shaper.AddPoleZero(50*CLHEP::microsecond, 0, wf.GetSamplingFreq());
+//     shaper.AddCRDifferentiator(1*CLHEP::microsecond, wf.GetSamplingFreq());
+//     for (int i=0;i<4;i++) shaper.AddRCIntegrator(1*CLHEP::microsecond, wf.GetSamplingFreq());
+//     shaper.SetRemoveBaseline(true, 200);
+//     shaper.Transform(&wf);
+//
+//   The recursion cannot be vectorized along time.  ProcessInterleaved()
+//   filters many channels stored sample-major instead, so that the inner
+//   loop runs across channels and is vectorized by the compiler.
+//   TransformBatch() does the same for a set of TDoubleWaveforms, by
+//   transposing blocks of fBatchWidth waveforms.
+//
+
+void TIIRFilter::AddSection(double b0, double b1, double b2, double a1, double a2)
+{
+  // Append a section, coefficients normalized to a0 = 1.
+  Section s;
+  s.fB0 = b0; s.fB1 = b1; s.fB2 = b2;
+  s.fA1 = a1; s.fA2 = a2;
+  fSections.push_back(s);
+}
+
+void TIIRFilter::AddSections(const TIIRFilter& other)
+{
+  // Append all sections of other.
+  fSections.insert(fSections.end(), other.fSections.begin(), other.fSections.end());
+}
+
+void TIIRFilter::AddRCIntegrator(double tau, double samplingFreq)
+{
+  // Low pass: y[n] = a*y[n-1] + (1-a)*x[n], a = exp(-T/tau), unit DC gain.
+  double a = TMath::Exp(-1./(tau*samplingFreq));
+  AddSection(1 - a, 0, 0, -a, 0);
+}
+
+void TIIRFilter::AddCRDifferentiator(double tau, double samplingFreq)
+{
+  // High pass: y[n] = a*(y[n-1] + x[n] - x[n-1]), a = exp(-T/tau).
+  double a = TMath::Exp(-1./(tau*samplingFreq));
+  AddSection(a, -a, 0, -a, 0);
+}
+
+void TIIRFilter::AddPoleZero(double tauDecay, double tauNew, double samplingFreq)
+{
+  // Pole-zero correction: cancel an exponential decay of time constant
+  // tauDecay and replace it with tauNew.  tauNew <= 0 means no decay, i.e.
+  // exponential pulses become steps.
+  double zero = TMath::Exp(-1./(tauDecay*samplingFreq));
+  double pole = (tauNew > 0) ? TMath::Exp(-1./(tauNew*samplingFreq)) : 1.0;
+  AddSection(1, -zero, 0, -pole, 0);
+}
+
+void TIIRFilter::AddButterworthLowPass(size_t order, double cutoff, double samplingFreq)
+{
+  AddButterworth(order, cutoff, samplingFreq, true);
+}
+
+void TIIRFilter::AddButterworthHighPass(size_t order, double cutoff, double samplingFreq)
+{
+  AddButterworth(order, cutoff, samplingFreq, false);
+}
+
+void TIIRFilter::AddButterworth(size_t order, double cutoff, double samplingFreq, bool lowPass)
+{
+  // Butterworth filter of the given order by bilinear transform (with
+  // prewarping of the cutoff), as order/2 biquads plus one first-order
+  // section for odd orders.
+  if (order == 0 || cutoff <= 0 || 2*cutoff >= samplingFreq) {
+    std::cerr << "Invalid Butterworth parameters" << std::endl;
+    return;
+  }
+  const double K = std::tan(TMath::Pi()*cutoff/samplingFreq);
+  for (size_t k=0;k<order/2;k++) {
+    double Q = 1./(2*std::sin(TMath::Pi()*(2*k + 1)/(2*order)));
+    double norm = 1./(1 + K/Q + K*K);
+    double a1 = 2*(K*K - 1)*norm;
+    double a2 = (1 - K/Q + K*K)*norm;
+    if (lowPass) AddSection(K*K*norm, 2*K*K*norm, K*K*norm, a1, a2);
+    else AddSection(norm, -2*norm, norm, a1, a2);
+  }
+  if (order % 2 == 1) {
+    double norm = 1./(1 + K);
+    if (lowPass) AddSection(K*norm, K*norm, 0, (K - 1)*norm, 0);
+    else AddSection(norm, -norm, 0, (K - 1)*norm, 0);
+  }
+}
+
+void TIIRFilter::TransformInPlace(TDoubleWaveform& input) const
+{
+  const size_t n = input.GetLength();
+  if (n == 0) return;
+  double baseline = 0.0;
+  if (fRemoveBaseline) {
+    size_t nb = (fBaselineSamples > 0 && fBaselineSamples < n) ? fBaselineSamples : n;
+    baseline = input.Sum(0, nb)/nb;
+  }
+
+  const size_t ns = fSections.size();
+  double* data = input.GetData();
+  if (ns == 0) {
+    // No sections, baseline removal only
+    if (baseline != 0.0) input -= baseline;
+    return;
+  }
+  if (ns == 1) {
+    // Most common case, keep the state in registers
+    const Section& s = fSections[0];
+    double z1 = 0, z2 = 0;
+    for (size_t i=0;i<n;i++) {
+      double x = data[i] - baseline;
+      double y = s.fB0*x + z1;
+      z1 = s.fB1*x - s.fA1*y + z2;
+      z2 = s.fB2*x - s.fA2*y;
+      data[i] = y;
+    }
+    return;
+  }
+
+  fState.assign(2*ns, 0.0);
+  double* z = &fState[0];
+  for (size_t i=0;i<n;i++) {
+    double x = data[i] - baseline;
+    for (size_t k=0;k<ns;k++) {
+      const Section& s = fSections[k];
+      double y = s.fB0*x + z[2*k];
+      z[2*k]   = s.fB1*x - s.fA1*y + z[2*k+1];
+      z[2*k+1] = s.fB2*x - s.fA2*y;
+      x = y;
+    }
+    data[i] = x;
+  }
+}
+
+void TIIRFilter::ProcessInterleaved(double* data, size_t nChannels, size_t nSamples) const
+{
+  // data holds sample i of channel ch at data[i*nChannels + ch].  The
+  // channels are independent, so the loops over ch have no dependency and
+  // are vectorized.
+  if (nChannels == 0 || nSamples == 0) return;
+  const size_t ns = fSections.size();
+  // State: z1 and z2 of every section for every channel, then baselines
+  fState.assign((2*ns + 1)*nChannels, 0.0);
+  double* base = &fState[2*ns*nChannels];
+  if (fRemoveBaseline) {
+    size_t nb = (fBaselineSamples > 0 && fBaselineSamples < nSamples) ?
+      fBaselineSamples : nSamples;
+    for (size_t i=0;i<nb;i++) {
+      const double* row = data + i*nChannels;
+      for (size_t ch=0;ch<nChannels;ch++) base[ch] += row[ch];
+    }
+    for (size_t ch=0;ch<nChannels;ch++) base[ch] /= nb;
+  }
+  if (ns == 0) {
+    // No sections, baseline removal only
+    if (!fRemoveBaseline) return;
+    for (size_t i=0;i<nSamples;i++) {
+      double* row = data + i*nChannels;
+      for (size_t ch=0;ch<nChannels;ch++) row[ch] -= base[ch];
+    }
+    return;
+  }
+  FilterLanes<0>(fSections, data, nChannels, nSamples, base, &fState[0]);
+}
+
+void TIIRFilter::TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const
+{
+  // Runs fBatchWidth waveforms at once, each in one lane of a transposed
+  // block.  Results are identical to TransformInPlace.
+  if (fSections.empty()) {
+    // No sections, baseline removal only
+    for (size_t i=0;i<waveforms.size();i++) TransformInPlace(*waveforms[i]);
+    return;
+  }
+  const size_t W = fBatchWidth;
+  const size_t ns = fSections.size();
+  fLaneBlock.resize(W*kLaneBlockLength);
+  for (size_t first=0;first<waveforms.size();first+=W) {
+    fState.assign((2*ns + 1)*W, 0.0);
+    double* base = &fState[2*ns*W];
+    for (size_t l=0;l<W && first+l<waveforms.size() && fRemoveBaseline;l++) {
+      const TDoubleWaveform& wf = *waveforms[first+l];
+      size_t n = wf.GetLength();
+      size_t nb = (fBaselineSamples > 0 && fBaselineSamples < n) ? fBaselineSamples : n;
+      if (nb > 0) base[l] = wf.Sum(0, nb)/nb;
+    }
+    size_t length = GetMaxLength(waveforms, first, W);
+    for (size_t start=0;start<length;start+=kLaneBlockLength) {
+      size_t n = std::min(length - start, (size_t)kLaneBlockLength);
+      GatherLanes(waveforms, first, W, start, n, &fLaneBlock[0]);
+      switch (W) {
+        case 4:  FilterLanes<4>(fSections, &fLaneBlock[0], W, n, base, &fState[0]); break;
+        case 16: FilterLanes<16>(fSections, &fLaneBlock[0], W, n, base, &fState[0]); break;
+        default: FilterLanes<8>(fSections, &fLaneBlock[0], W, n, base, &fState[0]); break;
+      }
+      ScatterLanes(waveforms, first, W, start, n, &fLaneBlock[0]);
+    }
+  }
+}
@@ -0,0 +1,73 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TIIRFilter.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Recursive (IIR) filter as a cascade of second-order sections in
+ * transposed direct form II, with standard shaping designs.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TIIRFilter_hh
+#define WAVE_TIIRFilter_hh
+
+#ifndef WAVE_TVWaveformTransformer_hh
+#include "TVWaveformTransformer.hh" 
+#endif
+#include <vector>
+
+class TIIRFilter : public TVWaveformTransformer
+{
+  public:
+    // y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+    struct Section {
+      double fB0, fB1, fB2, fA1, fA2;
+    };
+
+    TIIRFilter() : TVWaveformTransformer("TIIRFilter"), 
+      fRemoveBaseline(false), fBaselineSamples(0) {}
+  
+    virtual bool IsInPlace() const { return true; }
+
+    void AddSection(double b0, double b1, double b2, double a1, double a2);
+    void AddSections(const TIIRFilter& other);
+    void ClearSections() { fSections.clear(); }
+    size_t GetNumberOfSections() const { return fSections.size(); }
+    const Section& GetSection(size_t i) const { return fSections[i]; }
+
+    // Standard designs, appended to the cascade.  Times and frequencies in
+    // CLHEP units, samplingFreq is that of the waveforms to be filtered.
+    void AddRCIntegrator(double tau, double samplingFreq);
+    void AddCRDifferentiator(double tau, double samplingFreq);
+    void AddPoleZero(double tauDecay, double tauNew, double samplingFreq);
+    void AddButterworthLowPass(size_t order, double cutoff, double samplingFreq);
+    void AddButterworthHighPass(size_t order, double cutoff, double samplingFreq);
+
+    // Subtract the average of the first samples (all if 0) from the input,
+    // inside the filter loop.
+    void SetRemoveBaseline(bool remove, size_t samples = 0) 
+      { fRemoveBaseline = remove; fBaselineSamples = samples; }
+
+    // Filter nChannels channels stored interleaved (data[i*nChannels + ch]),
+    // in place.  The recursion runs across channels in the inner loop.
+    void ProcessInterleaved(double* data, size_t nChannels, size_t nSamples) const;
+    
+  protected:
+    virtual void TransformInPlace(TDoubleWaveform& input) const;
+    virtual void TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const;
+    void AddButterworth(size_t order, double cutoff, double samplingFreq, bool lowPass);
+
+    std::vector<Section> fSections;
+    bool                 fRemoveBaseline;
+    size_t               fBaselineSamples;
+    mutable std::vector<double> fState; // scratch for ProcessInterleaved
+};
+
+#endif /* WAVE_TIIRFilter_hh */
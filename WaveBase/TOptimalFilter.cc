@@ -0,0 +1,151 @@
+#include "TOptimalFilter.hh"
+#include "TFastFourierTransformFFTW.hh"
+#include "TSpectrumKernels.hh"
+#include "TMath.h"
+#include <limits>
+
+//______________________________________________________________________________
+// TOptimalFilter
+// 
+//   Optimal filter for a pulse of known shape S in stationary noise with
+//   variance sigma_k^2 in frequency bin k.  For a waveform V the best
+//   amplitude at a time offset of m samples and its chi-square are
+//
+//     A(m)    = sum_k S*_k V_k exp(2 pi i k m/N)/sigma_k^2 / norm
+//     chi2(m) = sum_k |V_k|^2/sigma_k^2 - A(m)^2 norm
+//
+//   with norm = sum_k |S_k|^2/sigma_k^2, all sums over the N bins of the
+//   DFT.  The kernel S*/(sigma^2 norm) is computed once and cached, so that
+//   each waveform costs one forward FFT, one complex multiplication and one
+//   inverse FFT, which directly gives A(m) for all offsets.  The
+//   transformed waveform is A(m); the offset with the largest A (inside the
+//   search window) is refined with a parabola through the neighbouring
+//   samples and gives GetAmplitude() and GetTimeOffset().
+//
+//   sigma_k^2 follows from the one-sided noise PSD P as N*fs*P_k/2 (N*fs*P_k
+//   for the DC and Nyquist bins), so that for pure noise the chi-square is
+//   distributed with about N degrees of freedom.
+//
+//   Offsets are circular: an offset m > N/2 is a pulse m - N samples
+//   earlier than the template.
+//
+
+void TOptimalFilter::SetTemplate(const TDoubleWaveform& aTemplate)
+{
+  fTemplate = aTemplate;
+  ResetKernel();
+}
+
+void TOptimalFilter::SetNoisePSD(const TDoubleWaveform& psd)
+{
+  fNoisePSD = psd;
+  ResetKernel();
+}
+
+double TOptimalFilter::GetAmplitudeResolution() const
+{
+  return (HaveKernel() && fNorm > 0) ? 1./TMath::Sqrt(fNorm) : 0.;
+}
+
+bool TOptimalFilter::HaveKernel() const
+{
+  // Build the kernel if needed.  A failure is remembered, so that it is
+  // not retried (and reported) for every waveform.
+  if (fKernel.GetLength() == 0 && !fKernelFailed) BuildKernel();
+  return fKernel.GetLength() > 0;
+}
+
+void TOptimalFilter::BuildKernel() const
+{
+  const size_t N = fTemplate.GetLength();
+  const size_t nb = N/2 + 1;
+  fNorm = 0.;
+  fKernelFailed = true;
+  if (N == 0 || fNoisePSD.GetLength() != nb) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Template and noise PSD lengths do not match");
+    fKernel.SetLength(0);
+    return;
+  }
+  TFastFourierTransformFFTW::GetFFT(N).PerformFFT(fTemplate, fKernel);
+  if (fKernel.GetLength() != nb) {
+    fKernel.SetLength(0);
+    return;
+  }
+
+  const double fs = fTemplate.GetSamplingFreq();
+  fWeight.assign(nb, 0.);
+  for (size_t k=0;k<nb;k++) {
+    // c counts the bin and its mirror image N-k
+    bool single = (k == 0) || (N % 2 == 0 && k == nb-1);
+    double c = single ? 1. : 2.;
+    double var = single ? N*fs*fNoisePSD[k] : 0.5*N*fs*fNoisePSD[k];
+    double invVar = (var > 0 && !(k == 0 && fIgnoreDC)) ? 1./var : 0.;
+    fWeight[k] = c*invVar;
+    fNorm += fWeight[k]*std::norm(fKernel[k]);
+    // The inverse FFT of the half spectrum already includes the mirror
+    // bins, so the kernel has no factor c.
+    fKernel[k] = std::conj(fKernel[k])*invVar;
+  }
+  if (fNorm <= 0) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotConfigured,
+      "Template has no power in the noise bandwidth");
+    fKernel.SetLength(0);
+    return;
+  }
+  TSpectrumKernels::Scale(fKernel, 1./fNorm);
+  fKernelFailed = false;
+}
+
+void TOptimalFilter::TransformInPlace(TDoubleWaveform& input) const
+{
+  const size_t N = input.GetLength();
+  // No results unless this waveform gets through
+  fAmplitude = fTimeOffset = fChiSquare = std::numeric_limits<double>::quiet_NaN();
+  fPeakIndex = N;
+  if (N != fTemplate.GetLength() || input.GetSamplingFreq() != fTemplate.GetSamplingFreq()) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Waveform does not match the template");
+    return;
+  }
+  if (!HaveKernel()) return;
+
+  TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(N);
+  fft.PerformFFT(input, fSpectrum);
+  const size_t nb = fKernel.GetLength();
+  if (fSpectrum.GetLength() != nb) return;
+
+  // Multiply by the kernel and sum |V|^2/sigma^2 in the same pass (the
+  // multiplication as in TSpectrumKernels::Multiply)
+  double* V = reinterpret_cast<double*>(fSpectrum.GetData());
+  const double* K = reinterpret_cast<const double*>(fKernel.GetData());
+  const double* w = &fWeight[0];
+  double sumV2 = 0.;
+  for (size_t k=0;k<nb;k++) {
+    double re = V[2*k], im = V[2*k+1];
+    sumV2 += w[k]*(re*re + im*im);
+    V[2*k]   = re*K[2*k] - im*K[2*k+1];
+    V[2*k+1] = re*K[2*k+1] + im*K[2*k];
+  }
+  double toffset = input.GetTOffset();
+  fft.PerformInverseFFTDestroyInput(input, fSpectrum);
+  input.SetTOffset(toffset);
+
+  // Peak search
+  size_t begin = (fSearchBegin < N) ? fSearchBegin : 0;
+  size_t end = (fSearchEnd < N) ? fSearchEnd : N;
+  if (end <= begin) end = N;
+  const double* A = input.GetData();
+  size_t peak = begin;
+  for (size_t m=begin;m<end;m++) if (A[m] > A[peak]) peak = m;
+
+  // Parabolic refinement with the circular neighbours
+  double a0 = A[(peak + N - 1) % N], a1 = A[peak], a2 = A[(peak + 1) % N];
+  double denom = a0 - 2*a1 + a2;
+  double delta = (denom < 0) ? 0.5*(a0 - a2)/denom : 0.;
+  if (delta > 0.5 || delta < -0.5) delta = 0.;
+  fPeakIndex = peak;
+  fAmplitude = a1 - 0.25*(a0 - a2)*delta;
+  fTimeOffset = (peak + delta)*input.GetSamplingPeriod();
+  fChiSquare = sumV2 - a1*a1*fNorm;
+}
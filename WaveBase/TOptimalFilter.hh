@@ -0,0 +1,82 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TOptimalFilter.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Frequency-domain optimal (matched) filter estimating amplitude, time
+ * offset and chi-square of a template in noise of known spectral density.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TOptimalFilter_hh
+#define WAVE_TOptimalFilter_hh
+
+#ifndef WAVE_TVWaveformTransformer_hh
+#include "TVWaveformTransformer.hh" 
+#endif
+#include <vector>
+
+class TOptimalFilter : public TVWaveformTransformer
+{
+  public:
+    TOptimalFilter() : TVWaveformTransformer("TOptimalFilter"), 
+      fIgnoreDC(false), fSearchBegin(0), fSearchEnd((size_t)-1), fKernelFailed(false),
+      fNorm(0.), fAmplitude(0.), fTimeOffset(0.), fChiSquare(0.), fPeakIndex(0) {}
+  
+    virtual bool IsInPlace() const { return true; }
+
+    // Pulse template, with the pulse at the time that corresponds to zero
+    // offset.  Input waveforms must have the same length and frequency.
+    void SetTemplate(const TDoubleWaveform& aTemplate);
+    // One-sided noise PSD with GetLength()/2 + 1 bins, as given by
+    // TPowerSpectrumAccumulator::GetPSD().  Bins <= 0 are not used.
+    void SetNoisePSD(const TDoubleWaveform& psd);
+    // Do not use the DC bin, i.e. ignore the baseline.
+    void SetIgnoreDC(bool ignore = true) { fIgnoreDC = ignore; ResetKernel(); }
+    // Restrict the peak search to offsets [begin, end) in samples.
+    void SetSearchWindow(size_t begin, size_t end) { fSearchBegin = begin; fSearchEnd = end; }
+
+    // Results of the last Transform().  The transformed waveform holds the
+    // amplitude estimate for every offset.  If the last Transform() failed
+    // (waveform not matching the template, invalid template or noise), the
+    // results are NaN and the peak index is the length of the waveform.
+    double GetAmplitude() const { return fAmplitude; }
+    double GetTimeOffset() const { return fTimeOffset; }
+    double GetChiSquare() const { return fChiSquare; }
+    size_t GetPeakIndex() const { return fPeakIndex; }
+    // Expected resolution of the amplitude, 1/sqrt(sum |S|^2/sigma^2).
+    double GetAmplitudeResolution() const;
+    
+  protected:
+    virtual void TransformInPlace(TDoubleWaveform& input) const;
+    void BuildKernel() const;
+    bool HaveKernel() const;
+    void ResetKernel() { fKernel.SetLength(0); fKernelFailed = false; }
+
+    TDoubleWaveform fTemplate;
+    TDoubleWaveform fNoisePSD;
+    bool            fIgnoreDC;
+    size_t          fSearchBegin;
+    size_t          fSearchEnd;
+
+    // Cached, rebuilt when the template or noise change
+    mutable TWaveformFT         fKernel;       // S*/(sigma^2 norm)
+    mutable bool                fKernelFailed; // not retried until a setting changes
+    mutable std::vector<double> fWeight;       // c_k/sigma_k^2 for chi-square
+    mutable double              fNorm;         // sum |S|^2/sigma^2 
+    mutable TWaveformFT         fSpectrum;
+
+    mutable double fAmplitude;
+    mutable double fTimeOffset;
+    mutable double fChiSquare;
+    mutable size_t fPeakIndex;
+};
+
+#endif /* WAVE_TOptimalFilter_hh */
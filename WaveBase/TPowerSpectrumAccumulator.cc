@@ -0,0 +1,139 @@
+#include "TPowerSpectrumAccumulator.hh"
+#include "TFastFourierTransformFFTW.hh"
+#include "TSpectrumKernels.hh"
+//______________________________________________________________________________
+//
+//  TPowerSpectrumAccumulator
+//
+//  Welch estimate of the power spectral density of noise: every trace is
+//  cut into (overlapping) segments, each segment is windowed and
+//  transformed, and |X|^2 is summed into a single spectrum.  Only the sums
+//  are kept, so any number of traces can be streamed through:
+//
+//    TPowerSpectrumAccumulator psd(2048, TWindowFunction::kHann);
+//    while (...next baseline trace wf...) psd.Add(wf);
+//    TDoubleWaveform spectrum;
+//    psd.GetPSD(spectrum);
+//
+//  The normalization is the usual one-sided density,
+//
+//    PSD[k] = 2 <|X_k|^2> / (fs * sum(w^2))
+//
+//  (without the factor 2 for the DC and Nyquist bins), so that the sum of
+//  PSD[k]*fs/N over all bins equals the mean squared (windowed) signal.
+//  Accumulators filled from different sets of traces can be combined with
+//  Merge().  The transforms come from TFastFourierTransformFFTW::GetFFT,
+//  whose cache (like that of TWindowFunction::Get) is not locked, so
+//  accumulators must be constructed and filled from one thread only.  The
+//  window is copied on construction and does not depend on the
+//  TWindowFunction cache afterwards.
+//______________________________________________________________________________
+
+//______________________________________________________________________________
+TPowerSpectrumAccumulator::TPowerSpectrumAccumulator(size_t segmentLength, 
+                                                     TWindowFunction::EWindow window,
+                                                     double windowParam, 
+                                                     size_t overlap) :
+  fSegmentLength(segmentLength > 0 ? segmentLength : 1),
+  fStep(0),
+  fWindow(TWindowFunction::Get(window, fSegmentLength, windowParam)),
+  fRemoveMean(true),
+  fSampleFreq(0.),
+  fSegments(0),
+  fSum(fSegmentLength/2 + 1, 0.)
+{
+  if (overlap == (size_t)-1) overlap = fSegmentLength/2;
+  fStep = (overlap < fSegmentLength) ? fSegmentLength - overlap : 1;
+  fSegment.SetLength(fSegmentLength);
+}
+
+//______________________________________________________________________________
+void TPowerSpectrumAccumulator::Reset()
+{
+  fSum.assign(fSum.size(), 0.);
+  fSegments = 0;
+  fSampleFreq = 0.;
+}
+
+//______________________________________________________________________________
+void TPowerSpectrumAccumulator::Add(const TDoubleWaveform& trace)
+{
+  if (fSampleFreq == 0.) fSampleFreq = trace.GetSamplingFreq();
+  else if (trace.GetSamplingFreq() != fSampleFreq) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kFrequencyMismatch,
+      "Trace has a different sampling frequency");
+    return;
+  }
+  const double* data = trace.GetData();
+  for (size_t start=0;start+fSegmentLength<=trace.GetLength();start+=fStep) {
+    AddSegment(data + start);
+  }
+}
+
+//______________________________________________________________________________
+void TPowerSpectrumAccumulator::Add(const std::vector<TDoubleWaveform*>& traces)
+{
+  for (size_t i=0;i<traces.size();i++) Add(*traces[i]);
+}
+
+//______________________________________________________________________________
+void TPowerSpectrumAccumulator::AddSegment(const double* data)
+{
+  const size_t n = fSegmentLength;
+  double mean = 0.;
+  if (fRemoveMean) {
+    for (size_t i=0;i<n;i++) mean += data[i];
+    mean /= n;
+  }
+  // Mean removal and window in one pass
+  const double* w = fWindow.GetData();
+  double* x = fSegment.GetData();
+  for (size_t i=0;i<n;i++) x[i] = (data[i] - mean)*w[i];
+
+  TFastFourierTransformFFTW::GetFFT(n).PerformFFT(fSegment, fSpectrum);
+  if (fSpectrum.GetLength() != fSum.size()) return;
+
+  TSpectrumKernels::AddPowerSpectrum(reinterpret_cast<const double*>(fSpectrum.GetData()), 
+                                     &fSum[0], fSum.size());
+  fSegments++;
+}
+
+//______________________________________________________________________________
+bool TPowerSpectrumAccumulator::Merge(const TPowerSpectrumAccumulator& other)
+{
+  if (other.fSegmentLength != fSegmentLength || other.fStep != fStep ||
+      other.fWindow.GetType() != fWindow.GetType() ||
+      other.fWindow.GetParam() != fWindow.GetParam() ||
+      other.fRemoveMean != fRemoveMean) {
+    std::cerr << "Accumulators have different settings" << std::endl;
+    return false;
+  }
+  if (other.fSegments == 0) return true;
+  if (fSegments > 0 && other.fSampleFreq != fSampleFreq) {
+    std::cerr << "Accumulators have different sampling frequencies" << std::endl;
+    return false;
+  }
+  fSampleFreq = other.fSampleFreq;
+  for (size_t k=0;k<fSum.size();k++) fSum[k] += other.fSum[k];
+  fSegments += other.fSegments;
+  return true;
+}
+
+//______________________________________________________________________________
+void TPowerSpectrumAccumulator::GetPSD(TDoubleWaveform& psd) const
+{
+  // psd gets the sampling frequency of the traces, like the TWaveformFT
+  // filled by TFastFourierTransformFFTW.
+  const size_t nb = fSum.size();
+  psd.SetLength(nb);
+  psd.SetSamplingFreq(fSampleFreq);
+  psd.SetTOffset(0.);
+  if (fSegments == 0 || fSampleFreq == 0.) {
+    psd.Zero();
+    return;
+  }
+  const double scale = 1./(fSegments*fSampleFreq*fWindow.GetSumSquares());
+  for (size_t k=0;k<nb;k++) psd[k] = 2*scale*fSum[k];
+  psd[0] *= 0.5;
+  if (fSegmentLength % 2 == 0) psd[nb-1] *= 0.5;
+}
@@ -0,0 +1,72 @@
+/**
+ *
+ * CLASS DECLARATION:  TPowerSpectrumAccumulator.hh
+ *
+ * DESCRIPTION:
+ *
+ * Averaged periodogram (Welch) power spectral density estimate,
+ * accumulated over an arbitrary number of traces.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TPowerSpectrumAccumulator_hh
+#define WAVE_TPowerSpectrumAccumulator_hh
+
+#ifndef WAVE_TWindowFunction_hh
+#include "TWindowFunction.hh"
+#endif
+#include <vector>
+
+class TPowerSpectrumAccumulator
+{
+  public:
+    // Segments of segmentLength samples, consecutive segments overlapping
+    // by overlap samples (default: half a segment).
+    TPowerSpectrumAccumulator(size_t segmentLength, 
+                              TWindowFunction::EWindow window = TWindowFunction::kHann,
+                              double windowParam = 0., 
+                              size_t overlap = (size_t)-1);
+
+    // Subtract the mean of each segment before windowing (default true).
+    void SetRemoveMean(bool remove) { fRemoveMean = remove; }
+
+    // Add all segments of a trace.  Traces are independent, samples left
+    // over at the end of a trace are not used.
+    void Add(const TDoubleWaveform& trace);
+    void Add(const std::vector<TDoubleWaveform*>& traces);
+    // Add the sums of another accumulator with the same settings, e.g. one
+    // filled from another set of traces.
+    bool Merge(const TPowerSpectrumAccumulator& other);
+    void Reset();
+
+    // One-sided PSD in (signal units)^2/(CLHEP frequency unit), i.e.
+    // integrating it over frequency gives the variance.  Bin i is at
+    // frequency GetFrequency(i).
+    void GetPSD(TDoubleWaveform& psd) const;
+    double GetFrequency(size_t bin) const { return bin*fSampleFreq/fSegmentLength; }
+    size_t GetNumberOfBins() const { return fSegmentLength/2 + 1; }
+    size_t GetSegmentLength() const { return fSegmentLength; }
+    Long64_t GetNumberOfSegments() const { return fSegments; }
+    double GetSamplingFreq() const { return fSampleFreq; }
+
+  protected:
+    void AddSegment(const double* data);
+
+    size_t                 fSegmentLength;
+    size_t                 fStep;
+    TWindowFunction        fWindow;       // copy, not affected by ClearCache()
+    bool                   fRemoveMean;
+    double                 fSampleFreq;   // of the traces added, 0 before the first
+    Long64_t               fSegments;
+    std::vector<double>    fSum;          // sum of |X|^2 per bin
+    TDoubleWaveform        fSegment;      // windowed segment
+    TWaveformFT            fSpectrum;
+};
+
+#endif /* WAVE_TPowerSpectrumAccumulator_hh */
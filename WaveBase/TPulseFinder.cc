@@ -0,0 +1,224 @@
+#include "TPulseFinder.hh"
+//______________________________________________________________________________
+//
+//  TPulseFinder
+//
+//  Finds all pulses in a waveform in one pass:
+//
+//    TPulseFinder finder;
+//    finder.SetThreshold(50, 10);
+//    finder.SetBaselineSamples(100);
+//    finder.SetTiming(TPulseFinder::kConstantFraction, 0.3);
+//    finder.SetMaxHits(16);
+//    size_t n = finder.FindPulses(wf);
+//    for (size_t i=0;i<n;i++) ... finder.GetHit(i).fTime ...
+//
+//  The search for a crossing tests blocks of samples with a branch-free
+//  loop (vectorized by the compiler) and only looks at single samples in
+//  the block where the crossing is.  Crossing times are interpolated
+//  linearly between samples.  Hits are stored in a vector that keeps its
+//  storage between calls, and nothing is printed: indices outside of the
+//  waveform cannot occur.  With SetMaxHits the search stops after that many
+//  hits (IsTruncated() is then set), so the vector never grows.
+//______________________________________________________________________________
+
+namespace {
+  const size_t kScanBlock = 16;
+
+  template<typename _Tp>
+  size_t FindAbove(const _Tp* data, size_t i, size_t n, double level)
+  {
+    // First index >= i with data > level, n if none.
+    while (i + kScanBlock <= n) {
+      int any = 0;
+      for (size_t j=0;j<kScanBlock;j++) any |= (data[i+j] > level);
+      if (any) break;
+      i += kScanBlock;
+    }
+    for (;i<n;i++) if (data[i] > level) return i;
+    return n;
+  }
+
+  template<typename _Tp>
+  size_t FindBelowAndMax(const _Tp* data, size_t i, size_t n, double level, size_t& peak)
+  {
+    // First index >= i with data < level, n if none.  peak is updated with
+    // the index of the maximum in between.
+    while (i + kScanBlock <= n) {
+      int any = 0;
+      _Tp max = data[i];
+      for (size_t j=0;j<kScanBlock;j++) {
+        any |= (data[i+j] < level);
+        max = (data[i+j] > max) ? data[i+j] : max;
+      }
+      if (any) break;
+      if (max > data[peak]) {
+        for (size_t j=0;j<kScanBlock;j++) if (data[i+j] == max) { peak = i+j; break; }
+      }
+      i += kScanBlock;
+    }
+    for (;i<n;i++) {
+      if (data[i] < level) return i;
+      if (data[i] > data[peak]) peak = i;
+    }
+    return n;
+  }
+
+  template<typename _Tp>
+  size_t FindEndOrValley(const _Tp* data, size_t i, size_t n, double level,
+                         double threshold, double hysteresis, size_t& peak, size_t& valley)
+  {
+    // As FindBelowAndMax, but the pulse also ends at a valley: once the
+    // signal has dropped by more than hysteresis from the peak, a rise by
+    // more than threshold above the minimum since then is a new pulse.  In
+    // that case the index of the minimum is stored in valley and the index
+    // of the rise is returned, otherwise valley is set to n.
+    bool falling = false;
+    valley = n;
+    for (;i<n;i++) {
+      double x = data[i];
+      if (x < level) break;
+      if (!falling) {
+        if (x > data[peak]) peak = i;
+        else if (data[peak] - x > hysteresis) {
+          falling = true;
+          valley = i;
+        }
+      } else if (x < data[valley]) {
+        valley = i;
+      } else if (x - data[valley] > threshold) {
+        return i;
+      }
+    }
+    valley = n;
+    return i;
+  }
+
+  template<typename _Tp>
+  double Crossing(const _Tp* data, size_t lowest, size_t peak, double level)
+  {
+    // Fractional index at which the rising edge before peak crosses level,
+    // searching back to lowest.
+    for (size_t j=peak;j>lowest;j--) {
+      if (data[j-1] <= level) {
+        double d = double(data[j]) - double(data[j-1]);
+        return (j-1) + ((d > 0) ? (level - data[j-1])/d : 1.);
+      }
+    }
+    return lowest;
+  }
+}
+
+//______________________________________________________________________________
+TPulseFinder::TPulseFinder() :
+  fThreshold(0.),
+  fHysteresis(0.),
+  fBaseline(0.),
+  fBaselineSamples(0),
+  fTiming(kLeadingEdge),
+  fFraction(0.5),
+  fRiseLow(0.1),
+  fRiseHigh(0.9),
+  fLastBaseline(0.),
+  fSplitPileUp(false),
+  fMaxHits(0),
+  fTruncated(false)
+{
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+size_t TPulseFinder::Find(const TTemplWaveform<_Tp>& wf)
+{
+  fHits.clear();
+  fTruncated = false;
+  const size_t n = wf.GetLength();
+  if (n == 0) return 0;
+  const _Tp* data = wf.GetData();
+
+  double baseline = fBaseline;
+  if (fBaselineSamples > 0) {
+    size_t nb = (fBaselineSamples < n) ? fBaselineSamples : n;
+    baseline = 0.;
+    for (size_t i=0;i<nb;i++) baseline += data[i];
+    baseline /= nb;
+  }
+  fLastBaseline = baseline;
+
+  const double high = baseline + fThreshold;
+  const double low = high - fHysteresis;
+  const double period = wf.GetSamplingPeriod();
+  size_t i = 0;
+  size_t valley = n;
+  while (i < n) {
+    // Edges are searched back to the end of the previous pulse
+    size_t lowest = fHits.empty() ? 0 : fHits.back().fEnd;
+    double trigger = high;
+    if (valley < n) {
+      // Piled-up pulse, i is already the start
+      trigger = data[valley] + fThreshold;
+    } else if ((i = FindAbove(data, i, n, high)) >= n) {
+      break;
+    }
+    if (fMaxHits > 0 && fHits.size() == fMaxHits) {
+      fTruncated = true;
+      break;
+    }
+    TPulseHit hit;
+    hit.fStart = i;
+    hit.fPeakIndex = i;
+    if (fSplitPileUp) {
+      i = FindEndOrValley(data, i, n, low, fThreshold, fHysteresis, hit.fPeakIndex, valley);
+      hit.fEnd = (valley < n) ? valley : i;
+    } else {
+      i = hit.fEnd = FindBelowAndMax(data, i, n, low, hit.fPeakIndex);
+    }
+    if (i <= hit.fStart) {
+      // Cannot happen with hysteresis >= 0, but never search from the
+      // same sample twice
+      i = hit.fStart + 1;
+      valley = n;
+    }
+    hit.fAmplitude = data[hit.fPeakIndex] - baseline;
+
+    double t = (fTiming == kConstantFraction) ?
+      Crossing(data, lowest, hit.fPeakIndex, baseline + fFraction*hit.fAmplitude) :
+      Crossing(data, lowest, hit.fStart, trigger);
+    hit.fTime = wf.GetTOffset() + t*period;
+    hit.fRiseTime = period*(
+      Crossing(data, lowest, hit.fPeakIndex, baseline + fRiseHigh*hit.fAmplitude) -
+      Crossing(data, lowest, hit.fPeakIndex, baseline + fRiseLow*hit.fAmplitude));
+    fHits.push_back(hit);
+  }
+  return fHits.size();
+}
+
+//______________________________________________________________________________
+size_t TPulseFinder::FindPulses(const TDoubleWaveform& wf)
+{
+  return Find(wf);
+}
+
+//______________________________________________________________________________
+size_t TPulseFinder::FindPulses(const TFloatWaveform& wf)
+{
+  return Find(wf);
+}
+
+//______________________________________________________________________________
+size_t TPulseFinder::FindPulses(const TIntWaveform& wf)
+{
+  return Find(wf);
+}
+
+//______________________________________________________________________________
+size_t TPulseFinder::FindPulses(const TShortWaveform& wf)
+{
+  return Find(wf);
+}
+
+//______________________________________________________________________________
+size_t TPulseFinder::FindPulses(const TUShortWaveform& wf)
+{
+  return Find(wf);
+}
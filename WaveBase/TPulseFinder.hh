@@ -0,0 +1,101 @@
+/**
+ *
+ * CLASS DECLARATION:  TPulseFinder.hh
+ *
+ * DESCRIPTION:
+ *
+ * Threshold-crossing pulse finder with hysteresis, leading-edge or
+ * constant-fraction timing and rise-time extraction.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TPulseFinder_hh
+#define WAVE_TPulseFinder_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+#include <vector>
+
+struct TPulseHit
+{
+  size_t fStart;      // first sample above the threshold
+  size_t fEnd;        // first sample below the lower (hysteresis) threshold
+  size_t fPeakIndex;  // sample of the maximum
+  double fAmplitude;  // maximum above baseline
+  double fTime;       // timing point, CLHEP time including the TOffset
+  double fRiseTime;   // CLHEP time between the rise-time fractions
+};
+
+class TPulseFinder
+{
+  public:
+    enum ETiming { kLeadingEdge, kConstantFraction };
+
+    TPulseFinder();
+
+    // A pulse starts when the signal exceeds threshold and ends when it
+    // falls back below threshold - hysteresis.  Both relative to baseline,
+    // a negative hysteresis is taken as 0.
+    void SetThreshold(double threshold, double hysteresis = 0.) 
+      { fThreshold = threshold; fHysteresis = (hysteresis > 0.) ? hysteresis : 0.; }
+    void SetBaseline(double baseline) { fBaseline = baseline; fBaselineSamples = 0; }
+    // Use the average of the first samples of every waveform as baseline.
+    void SetBaselineSamples(size_t samples) { fBaselineSamples = samples; }
+    // Timing point: interpolated crossing of the threshold (leading edge)
+    // or of fraction*amplitude (constant fraction).
+    void SetTiming(ETiming timing, double fraction = 0.5) 
+      { fTiming = timing; fFraction = fraction; }
+    // Fractions of the amplitude between which the rise time is measured.
+    void SetRiseTimeFractions(double low = 0.1, double high = 0.9) 
+      { fRiseLow = low; fRiseHigh = high; }
+    // Split pulses that pile up: after a drop of more than the hysteresis
+    // below the peak, a rise of more than the threshold starts a new pulse.
+    void SetSplitPileUp(bool split = true) { fSplitPileUp = split; }
+    // Store at most this many hits (0: no limit).  The storage is reserved,
+    // so that FindPulses never allocates; a waveform with more pulses is
+    // reported by IsTruncated().
+    void SetMaxHits(size_t hits) { fMaxHits = hits; fHits.reserve(hits); }
+    size_t GetMaxHits() const { return fMaxHits; }
+
+    // Find all pulses, return the number found.  The hits are valid until
+    // the next call.
+    size_t FindPulses(const TDoubleWaveform& wf);
+    size_t FindPulses(const TFloatWaveform& wf);
+    size_t FindPulses(const TIntWaveform& wf);
+    size_t FindPulses(const TShortWaveform& wf);
+    size_t FindPulses(const TUShortWaveform& wf);
+
+    size_t GetNumberOfHits() const { return fHits.size(); }
+    const TPulseHit& GetHit(size_t i) const { return fHits[i]; }
+    const std::vector<TPulseHit>& GetHits() const { return fHits; }
+    double GetLastBaseline() const { return fLastBaseline; }
+    // True if the last waveform had more pulses than SetMaxHits, the
+    // search then stopped at the last stored hit.
+    bool IsTruncated() const { return fTruncated; }
+
+  protected:
+    template<typename _Tp> size_t Find(const TTemplWaveform<_Tp>& wf);
+
+    double  fThreshold;
+    double  fHysteresis;
+    double  fBaseline;
+    size_t  fBaselineSamples;
+    ETiming fTiming;
+    double  fFraction;
+    double  fRiseLow;
+    double  fRiseHigh;
+    double  fLastBaseline;
+    bool    fSplitPileUp;
+    size_t  fMaxHits;
+    bool    fTruncated;
+    std::vector<TPulseHit> fHits;
+};
+
+#endif /* WAVE_TPulseFinder_hh */
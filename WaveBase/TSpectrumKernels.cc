@@ -0,0 +1,157 @@
+#include "TSpectrumKernels.hh"
+#include "TMath.h"
+//______________________________________________________________________________
+//
+//  TSpectrumKernels
+//
+//  Element-wise kernels for the frequency-domain filters.  Operations on
+//  std::complex<double> go through calls that (for IEEE conformance of
+//  NaN/inf handling) GCC only vectorizes with -ffast-math.  These kernels
+//  reinterpret the spectra as arrays of (re, im) pairs, which the C++
+//  standard guarantees for std::complex, and spell out the arithmetic so
+//  that the loops vectorize with the default flags.
+//______________________________________________________________________________
+
+namespace {
+  bool CheckLengths(size_t a, size_t b)
+  {
+    if (a == b) return true;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Spectra have different lengths");
+    return false;
+  }
+
+  inline double* Raw(TWaveformFT& wf) 
+  { 
+    return reinterpret_cast<double*>(wf.GetData()); 
+  }
+  inline const double* Raw(const TWaveformFT& wf) 
+  { 
+    return reinterpret_cast<const double*>(wf.GetData()); 
+  }
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::Multiply(const double* a, const double* b, double* out, size_t n)
+{
+  for (size_t k=0;k<n;k++) {
+    double re = a[2*k]*b[2*k] - a[2*k+1]*b[2*k+1];
+    double im = a[2*k]*b[2*k+1] + a[2*k+1]*b[2*k];
+    out[2*k] = re;
+    out[2*k+1] = im;
+  }
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::MultiplyConjugate(const double* a, const double* b, double* out, size_t n)
+{
+  for (size_t k=0;k<n;k++) {
+    double re = a[2*k]*b[2*k] + a[2*k+1]*b[2*k+1];
+    double im = a[2*k+1]*b[2*k] - a[2*k]*b[2*k+1];
+    out[2*k] = re;
+    out[2*k+1] = im;
+  }
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::Scale(const double* a, const double* h, double* out, size_t n)
+{
+  for (size_t k=0;k<n;k++) {
+    out[2*k] = a[2*k]*h[k];
+    out[2*k+1] = a[2*k+1]*h[k];
+  }
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::AddPowerSpectrum(const double* a, double* sum, size_t n)
+{
+  for (size_t k=0;k<n;k++) sum[k] += a[2*k]*a[2*k] + a[2*k+1]*a[2*k+1];
+}
+
+//______________________________________________________________________________
+bool TSpectrumKernels::Multiply(TWaveformFT& a, const TWaveformFT& b)
+{
+  if (!CheckLengths(a.GetLength(), b.GetLength())) return false;
+  Multiply(Raw(a), Raw(b), Raw(a), a.GetLength());
+  return true;
+}
+
+//______________________________________________________________________________
+bool TSpectrumKernels::Multiply(const TWaveformFT& a, const TWaveformFT& b, TWaveformFT& out)
+{
+  if (!CheckLengths(a.GetLength(), b.GetLength())) return false;
+  out.MakeSimilarTo(a);
+  Multiply(Raw(a), Raw(b), Raw(out), a.GetLength());
+  return true;
+}
+
+//______________________________________________________________________________
+bool TSpectrumKernels::MultiplyConjugate(TWaveformFT& a, const TWaveformFT& b)
+{
+  if (!CheckLengths(a.GetLength(), b.GetLength())) return false;
+  MultiplyConjugate(Raw(a), Raw(b), Raw(a), a.GetLength());
+  return true;
+}
+
+//______________________________________________________________________________
+bool TSpectrumKernels::MultiplyConjugate(const TWaveformFT& a, const TWaveformFT& b, 
+                                         TWaveformFT& out)
+{
+  if (!CheckLengths(a.GetLength(), b.GetLength())) return false;
+  out.MakeSimilarTo(a);
+  MultiplyConjugate(Raw(a), Raw(b), Raw(out), a.GetLength());
+  return true;
+}
+
+//______________________________________________________________________________
+bool TSpectrumKernels::Scale(TWaveformFT& a, const TDoubleWaveform& h)
+{
+  if (!CheckLengths(a.GetLength(), h.GetLength())) return false;
+  Scale(Raw(a), h.GetData(), Raw(a), a.GetLength());
+  return true;
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::Scale(TWaveformFT& a, double value)
+{
+  double* x = Raw(a);
+  const size_t n = 2*a.GetLength();
+  for (size_t i=0;i<n;i++) x[i] *= value;
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::PowerSpectrum(const TWaveformFT& a, TDoubleWaveform& out)
+{
+  out.MakeSimilarTo(a);
+  out.Zero();
+  AddPowerSpectrum(Raw(a), out.GetData(), a.GetLength());
+}
+
+//______________________________________________________________________________
+bool TSpectrumKernels::AddPowerSpectrum(const TWaveformFT& a, TDoubleWaveform& sum)
+{
+  if (!CheckLengths(a.GetLength(), sum.GetLength())) return false;
+  AddPowerSpectrum(Raw(a), sum.GetData(), a.GetLength());
+  return true;
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::Magnitude(const TWaveformFT& a, TDoubleWaveform& out)
+{
+  out.MakeSimilarTo(a);
+  const double* x = Raw(a);
+  double* y = out.GetData();
+  const size_t n = a.GetLength();
+  for (size_t k=0;k<n;k++) y[k] = TMath::Sqrt(x[2*k]*x[2*k] + x[2*k+1]*x[2*k+1]);
+}
+
+//______________________________________________________________________________
+void TSpectrumKernels::Phase(const TWaveformFT& a, TDoubleWaveform& out)
+{
+  // In (-pi, pi].  atan2 is a library call, so this one is not vectorized.
+  out.MakeSimilarTo(a);
+  const double* x = Raw(a);
+  double* y = out.GetData();
+  const size_t n = a.GetLength();
+  for (size_t k=0;k<n;k++) y[k] = TMath::ATan2(x[2*k+1], x[2*k]);
+}
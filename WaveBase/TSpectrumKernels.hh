@@ -0,0 +1,57 @@
+/**
+ *
+ * CLASS DECLARATION:  TSpectrumKernels.hh
+ *
+ * DESCRIPTION:
+ *
+ * Element-wise operations on spectra (TWaveformFT) written on the
+ * interleaved real/imaginary layout so that they vectorize.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TSpectrumKernels_hh
+#define WAVE_TSpectrumKernels_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+
+class TSpectrumKernels
+{
+  public:
+    // Spectra are in the half-spectrum layout of
+    // TFastFourierTransformFFTW::PerformFFT, but any length works.  All
+    // binary operations require equal lengths and return false otherwise.
+
+    // a *= b, out = a*b
+    static bool Multiply(TWaveformFT& a, const TWaveformFT& b);
+    static bool Multiply(const TWaveformFT& a, const TWaveformFT& b, TWaveformFT& out);
+    // a *= conj(b), out = a*conj(b), e.g. for cross-correlation
+    static bool MultiplyConjugate(TWaveformFT& a, const TWaveformFT& b);
+    static bool MultiplyConjugate(const TWaveformFT& a, const TWaveformFT& b, TWaveformFT& out);
+    // a *= h for a real transfer function h, a *= value
+    static bool Scale(TWaveformFT& a, const TDoubleWaveform& h);
+    static void Scale(TWaveformFT& a, double value);
+
+    // |X|^2, |X|, arg(X) of each bin
+    static void PowerSpectrum(const TWaveformFT& a, TDoubleWaveform& out);
+    static void Magnitude(const TWaveformFT& a, TDoubleWaveform& out);
+    static void Phase(const TWaveformFT& a, TDoubleWaveform& out);
+    // sum += |X|^2, for averaging spectra
+    static bool AddPowerSpectrum(const TWaveformFT& a, TDoubleWaveform& sum);
+
+    // The same on raw arrays of n complex values, stored as 2*n doubles
+    // (re, im).  out may be equal to a.
+    static void Multiply(const double* a, const double* b, double* out, size_t n);
+    static void MultiplyConjugate(const double* a, const double* b, double* out, size_t n);
+    static void Scale(const double* a, const double* h, double* out, size_t n);
+    static void AddPowerSpectrum(const double* a, double* sum, size_t n);
+};
+
+#endif /* WAVE_TSpectrumKernels_hh */
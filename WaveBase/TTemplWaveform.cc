@@ -270,8 +270,11 @@ TTemplWaveform<_Tp> TTemplWaveform<_Tp>::SubWaveform(size_t begin, size_t end) c
 template<typename _Tp>
 void TTemplWaveform<_Tp>::Append(const TTemplWaveform<_Tp>& wf)
 {
+  // Append wf to the end of this waveform.  When appending many pieces, call
+  // Reserve() first to avoid reallocating the data as it grows.
   if (wf.GetSamplingFreq() != GetSamplingFreq() ) {
-    std::cerr << "Cannot append waveforms with different frequencies" << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kFrequencyMismatch,
+      "Cannot append waveforms with different frequencies");
     return;
   }
   fData.insert( fData.end(), wf.GetVectorData().begin(), wf.GetVectorData().end() );
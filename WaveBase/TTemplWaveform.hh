@@ -6,6 +6,7 @@
 #ifndef HEP_SYSTEM_OF_UNITS_H
 #include "SystemOfUnits.hh"
 #endif
+#include "TWaveformDiagnostics.hh"
 #include <vector> 
 #include <string> 
 #include <iostream> 
@@ -16,6 +17,7 @@ namespace TTemplWFUtil {
 }
 
 class TH1D;
+template<class _Expr> class TWaveformExpr;
 template<typename _Tp>
 class TTemplWaveform : public TObject {
    public:
@@ -69,6 +71,12 @@ class TTemplWaveform : public TObject {
       fData.resize(length); 
     }
 
+    void Reserve( size_t length )
+    {
+      // Reserve storage for length samples, e.g. before repeated Append()
+      fData.reserve(length);
+    }
+
     size_t GetLength() const 
     { 
       // Return the length of the waveform
@@ -142,7 +150,8 @@ class TTemplWaveform : public TObject {
       // Vector multiplication.  Waveforms must be similar (defined by
       // IsSimilarTo()) or this function will return without doing anything.
       if (!IsSimilarTo(other)) {
-        std::cout << "Waveforms are not similar" << std::endl;
+        TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotSimilar,
+          "Waveforms are not similar");
       } else {
         size_t n = GetLength();
         for(size_t i=0; i<n; i++) fData[i] *= static_cast<_Tp>(other[i]);
@@ -157,7 +166,8 @@ class TTemplWaveform : public TObject {
       // or this function will return without doing anything.  Divide by zero
       // is not checked!
       if (!IsSimilarTo(other)) {
-        std::cout << "Waveforms are not similar" << std::endl;
+        TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotSimilar,
+          "Waveforms are not similar");
       } else {
         size_t n = GetLength();
         for(size_t i=0; i<n; i++) fData[i] /= static_cast<_Tp>(other[i]);
@@ -171,7 +181,8 @@ class TTemplWaveform : public TObject {
       // Vector subtraction.  Waveforms must be similar (defined by
       // IsSimilarTo()) or this function will return without doing anything.
       if (!IsSimilarTo(other)) {
-        std::cout << "Waveforms are not similar" << std::endl;
+        TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotSimilar,
+          "Waveforms are not similar");
       } else {
         size_t n = GetLength();
         for(size_t i=0; i<n; i++) fData[i] -= static_cast<_Tp>(other[i]);
@@ -185,7 +196,8 @@ class TTemplWaveform : public TObject {
       // Vector addition.  Waveforms must be similar (defined by IsSimilarTo())
       // or this function will return without doing anything.
       if (!IsSimilarTo(other)) {
-        std::cout << "Waveforms are not similar" << std::endl;
+        TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotSimilar,
+          "Waveforms are not similar");
       } else {
         size_t n = GetLength();
         for(size_t i=0; i<n; i++) fData[i] += static_cast<_Tp>(other[i]);
@@ -280,6 +292,13 @@ class TTemplWaveform : public TObject {
       return *this;
     }
 
+#ifndef __CINT__
+    // Evaluate an expression such as (a - b)*k + c in a single loop, see
+    // TWaveformExpression.hh.
+    template<class _Expr>
+    TTemplWaveform<_Tp>& operator=( const TWaveformExpr<_Expr>& expr );
+#endif
+
     virtual ~TTemplWaveform() {}
  
     //virtual Draw(Option_t *opt);
@@ -381,14 +400,16 @@ size_t TTemplWaveform<_Tp>::GetIndexAtTime(Double_t Time) const
 {
   // Return the index of the element corresponding to time Time.  If Time lies
   // between two elements of the waveform, we return the index of the earlier
-  // one.  If Time does not lie within the waveform, log an error and return
-  // GetLength().
+  // one.  If Time does not lie within the waveform, report an error (see
+  // TWaveformDiagnostics) and return GetLength().
   if(Time < GetTOffset()) {
-    std::cerr << "Input time precedes the waveform.  Returning GetLength()." << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kTimeOutOfRange,
+      "Input time precedes the waveform.  Returning GetLength().");
     return GetLength();
   }
   if(Time >= GetSamplingPeriod()*GetLength() + GetTOffset()) {
-    std::cerr << "Input time follows the waveform.  Returning GetLength()." << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kTimeOutOfRange,
+      "Input time follows the waveform.  Returning GetLength().");
     return GetLength();
   }
   return static_cast<size_t>( (Time - GetTOffset())*GetSamplingFreq() );
@@ -398,10 +419,11 @@ template <typename _Tp>
 Double_t TTemplWaveform<_Tp>::GetTimeAtIndex(size_t Index) const
 {
   // Return the time corresponding to the element at index Index.  If Index >
-  // GetLength(), log an error and return the time that would correspond to
-  // index GetLength().
+  // GetLength(), report an error (see TWaveformDiagnostics) and return the
+  // time that would correspond to index GetLength().
   if(Index > GetLength()) {
-    std::cerr << "Input index follows the waveform.  Returning a time that follows the waveform as well." << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kIndexOutOfRange,
+      "Input index follows the waveform.  Returning a time that follows the waveform as well.");
     return GetSamplingPeriod()*GetLength() + GetTOffset();
   }
   return GetSamplingPeriod()*Index + GetTOffset();
@@ -0,0 +1,270 @@
+#include "TTemplWaveformPrefetcher.hh"
+#include "TTemplWaveformTree.hh"
+#include "TFile.h"
+#include "TTree.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
+//______________________________________________________________________________
+//
+//  TTemplWaveformPrefetcher
+//
+//  Overlaps reading/decompression of waveform entries with their
+//  processing.  Background threads read entries of a tree written by
+//  TTemplWaveformTreeWriter into a ring of preallocated waveforms, while the
+//  caller (or several worker threads) process the entries already
+//  decoded:
+//
+//    TShortWaveformPrefetcher prefetch("run.root", "wfTree", 64, 2);
+//    prefetch.Start();
+//    Long64_t entry;
+//    Int_t channel;
+//    while (TShortWaveform* wf = prefetch.Acquire(entry, channel)) {
+//      ... process *wf ...
+//      prefetch.Release(entry);
+//    }
+//
+//  Entry e always goes to ring slot (e - first) % ringSize, and a slot is
+//  only refilled once the entry it holds has been released.  This gives
+//  backpressure (decoding stops when ringSize entries are waiting) and
+//  in-order delivery, independently of how many decoding threads there
+//  are.  Every decoding thread opens its own TFile, since trees are not
+//  thread-safe, and takes contiguous blocks of entries: the rest of the
+//  cluster of the next entry not yet taken, at most ringSize/nThreads
+//  entries so that all threads fit in the ring.  Each basket is then read
+//  and decompressed by one thread only, except at the edges of the blocks.
+//  With more than one thread, a ring holding nThreads clusters avoids
+//  these edges (and the cache of a thread, SetCacheSize, reads whole
+//  clusters).
+//
+//  The waveforms in the ring keep their storage between entries, so after
+//  the first pass over the ring no allocations are made (or none at all
+//  with SetExpectedLength()).
+//______________________________________________________________________________
+
+//______________________________________________________________________________
+template<typename _Tp>
+TTemplWaveformPrefetcher<_Tp>::TTemplWaveformPrefetcher(const char* fileName,
+                                                        const char* treeName,
+                                                        size_t ringSize,
+                                                        size_t decodeThreads) :
+  fFileName(fileName),
+  fTreeName(treeName),
+  fNThreads(decodeThreads > 0 ? decodeThreads : 1),
+  fCacheSize(0),
+  fExpectedLength(0),
+  fRing(ringSize > 0 ? ringSize : 1),
+  fMutex(new TMutex),
+  fChanged(NULL),
+  fFirst(0),
+  fLast(0),
+  fNextToDeliver(0),
+  fNextToClaim(0),
+  fStop(false),
+  fError(false)
+{
+  fChanged = new TCondition(fMutex);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+TTemplWaveformPrefetcher<_Tp>::~TTemplWaveformPrefetcher()
+{
+  Stop();
+  delete fChanged;
+  delete fMutex;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Long64_t TTemplWaveformPrefetcher<_Tp>::CountEntries()
+{
+  TFile* file = TFile::Open(fFileName.c_str());
+  if (file == NULL || file->IsZombie()) {
+    std::cerr << "Unable to open " << fFileName << std::endl;
+    delete file;
+    return -1;
+  }
+  TTree* tree = dynamic_cast<TTree*>(file->Get(fTreeName.c_str()));
+  Long64_t entries = (tree) ? tree->GetEntries() : -1;
+  if (!tree) std::cerr << "Tree " << fTreeName << " not found" << std::endl;
+  delete file;
+  return entries;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+bool TTemplWaveformPrefetcher<_Tp>::Start(Long64_t first, Long64_t last)
+{
+  // Start the decoding threads.  Returns false if the tree cannot be opened.
+  Stop();
+  Long64_t entries = CountEntries();
+  if (entries < 0) return false;
+  if (first < 0) first = 0;
+  if (last < 0 || last > entries) last = entries;
+
+  fFirst = first;
+  fLast = last;
+  fNextToDeliver = first;
+  fNextToClaim = first;
+  fStop = false;
+  fError = false;
+  for (size_t i=0;i<fRing.size();i++) {
+    fRing[i].fEntry = first + i;
+    fRing[i].fChannel = 0;
+    fRing[i].fState = kFree;
+    if (fExpectedLength > 0) fRing[i].fWF.Reserve(fExpectedLength);
+  }
+
+  TThread::Initialize();
+  for (size_t i=0;i<fNThreads;i++) {
+    TThread* thread = new TThread("TTemplWaveformPrefetcher",
+                                  &TTemplWaveformPrefetcher<_Tp>::DecodeThread,
+                                  this);
+    fThreads.push_back(thread);
+    thread->Run();
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformPrefetcher<_Tp>::Stop()
+{
+  fMutex->Lock();
+  fStop = true;
+  fChanged->Broadcast();
+  fMutex->UnLock();
+  for (size_t i=0;i<fThreads.size();i++) {
+    fThreads[i]->Join();
+    delete fThreads[i];
+  }
+  fThreads.clear();
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void* TTemplWaveformPrefetcher<_Tp>::DecodeThread(void* self)
+{
+  static_cast<TTemplWaveformPrefetcher<_Tp>*>(self)->Decode();
+  return NULL;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformPrefetcher<_Tp>::Decode()
+{
+  // Body of the decoding threads.
+  TFile* file = TFile::Open(fFileName.c_str());
+  TTree* tree = (file && !file->IsZombie()) ?
+    dynamic_cast<TTree*>(file->Get(fTreeName.c_str())) : NULL;
+  if (tree == NULL) {
+    fMutex->Lock();
+    fError = true;
+    fChanged->Broadcast();
+    fMutex->UnLock();
+    delete file;
+    return;
+  }
+  TTemplWaveformTreeReader<_Tp> reader(tree);
+  if (fCacheSize > 0) reader.SetCacheSize(fCacheSize);
+
+  const Long64_t ringSize = fRing.size();
+  Long64_t entry = 0, end = 0;
+  while (entry < end || ClaimBlock(tree, entry, end)) {
+    Slot& slot = fRing[(entry - fFirst) % ringSize];
+    fMutex->Lock();
+    while (!fStop && !(slot.fState == kFree && slot.fEntry == entry)) fChanged->Wait();
+    if (fStop) {
+      fMutex->UnLock();
+      break;
+    }
+    slot.fState = kDecoding;
+    fMutex->UnLock();
+
+    // The slot belongs to this thread until it is marked ready.
+    bool ok = reader.GetEntry(entry, slot.fWF);
+
+    fMutex->Lock();
+    slot.fChannel = reader.GetChannel();
+    slot.fState = kReady;
+    if (!ok) fError = true;
+    fChanged->Broadcast();
+    fMutex->UnLock();
+    entry++;
+  }
+  delete file;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+bool TTemplWaveformPrefetcher<_Tp>::ClaimBlock(TTree* tree, Long64_t& begin, Long64_t& end)
+{
+  // Take the next block of entries [begin, end) for the calling thread,
+  // false when all entries are taken or the threads are stopped.  Blocks
+  // end at cluster boundaries (the same in every thread's tree).
+  const Long64_t maxBlock = (fRing.size() > fNThreads) ? fRing.size()/fNThreads : 1;
+  fMutex->Lock();
+  begin = fNextToClaim;
+  if (fStop || begin >= fLast) {
+    fMutex->UnLock();
+    return false;
+  }
+  TTree::TClusterIterator clusters = tree->GetClusterIterator(begin);
+  clusters();
+  end = clusters.GetNextEntry();
+  if (end <= begin || end > begin + maxBlock) end = begin + maxBlock;
+  if (end > fLast) end = fLast;
+  fNextToClaim = end;
+  fMutex->UnLock();
+  return true;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+TTemplWaveform<_Tp>* TTemplWaveformPrefetcher<_Tp>::Acquire(Long64_t& entry, Int_t& channel)
+{
+  fMutex->Lock();
+  if (fError || fNextToDeliver >= fLast) {
+    fMutex->UnLock();
+    return NULL;
+  }
+  Long64_t next = fNextToDeliver++;
+  Slot& slot = fRing[(next - fFirst) % static_cast<Long64_t>(fRing.size())];
+  while (!fStop && !fError && !(slot.fState == kReady && slot.fEntry == next)) {
+    fChanged->Wait();
+  }
+  if (slot.fState != kReady || slot.fEntry != next) {
+    fMutex->UnLock();
+    return NULL;
+  }
+  slot.fState = kInUse;
+  entry = next;
+  channel = slot.fChannel;
+  fMutex->UnLock();
+  return &slot.fWF;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformPrefetcher<_Tp>::Release(Long64_t entry)
+{
+  // Give the slot of entry back to the decoding threads.
+  if (entry < fFirst || entry >= fLast) return;
+  fMutex->Lock();
+  Slot& slot = fRing[(entry - fFirst) % static_cast<Long64_t>(fRing.size())];
+  if (slot.fState == kInUse && slot.fEntry == entry) {
+    slot.fEntry = entry + fRing.size();
+    slot.fState = kFree;
+    fChanged->Broadcast();
+  }
+  fMutex->UnLock();
+}
+
+//______________________________________________________________________________
+// The following are necessary to ensure that the above functions are generated.
+template class TTemplWaveformPrefetcher<Int_t>;
+template class TTemplWaveformPrefetcher<UShort_t>;
+template class TTemplWaveformPrefetcher<Short_t>;
+template class TTemplWaveformPrefetcher<Double_t>;
+template class TTemplWaveformPrefetcher<Float_t>;
@@ -0,0 +1,99 @@
+/**
+ *
+ * CLASS DECLARATION:  TTemplWaveformPrefetcher.hh
+ *
+ * DESCRIPTION:
+ *
+ * Reads and decodes waveform entries on background threads into a bounded
+ * ring of preallocated waveforms, delivering them in order to the
+ * processing threads.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TTemplWaveformPrefetcher_hh
+#define WAVE_TTemplWaveformPrefetcher_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+#include <string>
+#include <vector>
+
+class TThread;
+class TTree;
+class TMutex;
+class TCondition;
+
+template<typename _Tp>
+class TTemplWaveformPrefetcher
+{
+  public:
+    TTemplWaveformPrefetcher(const char* fileName, const char* treeName = "wfTree",
+                             size_t ringSize = 64, size_t decodeThreads = 1);
+    virtual ~TTemplWaveformPrefetcher();
+
+    // Size of the TTreeCache of each decoding thread, call before Start().
+    void SetCacheSize(Long64_t bytes) { fCacheSize = bytes; }
+    // Reserve this many samples in every ring slot, call before Start().
+    void SetExpectedLength(size_t length) { fExpectedLength = length; }
+
+    // Start decoding entries [first, last), last < 0 means up to the end.
+    bool Start(Long64_t first = 0, Long64_t last = -1);
+    // Stop the decoding threads.  Called by the destructor.
+    void Stop();
+
+    // Block until the next entry (in entry order) has been decoded and
+    // return it, or NULL once all entries have been delivered.  Can be
+    // called from several worker threads.  The waveform stays valid until
+    // it is passed to Release().
+    TTemplWaveform<_Tp>* Acquire(Long64_t& entry, Int_t& channel);
+    void Release(Long64_t entry);
+
+  protected:
+    enum ESlotState { kFree, kDecoding, kReady, kInUse };
+    struct Slot {
+      TTemplWaveform<_Tp> fWF;
+      Long64_t            fEntry;   // entry held or, when free, expected next
+      Int_t               fChannel;
+      ESlotState          fState;
+    };
+
+    static void* DecodeThread(void* self);
+    void Decode();
+    bool ClaimBlock(TTree* tree, Long64_t& begin, Long64_t& end);
+    Long64_t CountEntries();
+
+    std::string              fFileName;
+    std::string              fTreeName;
+    size_t                   fNThreads;
+    Long64_t                 fCacheSize;
+    size_t                   fExpectedLength;
+    std::vector<Slot>        fRing;
+    std::vector<TThread*>    fThreads;
+    TMutex*                  fMutex;
+    TCondition*              fChanged;     // any slot changed state
+    Long64_t                 fFirst;
+    Long64_t                 fLast;
+    Long64_t                 fNextToDeliver;
+    Long64_t                 fNextToClaim;  // first entry no thread has taken
+    bool                     fStop;
+    bool                     fError;
+
+  private:
+    TTemplWaveformPrefetcher(const TTemplWaveformPrefetcher<_Tp>&);
+    TTemplWaveformPrefetcher<_Tp>& operator=(const TTemplWaveformPrefetcher<_Tp>&);
+};
+
+typedef TTemplWaveformPrefetcher<Double_t> TDoubleWaveformPrefetcher;
+typedef TTemplWaveformPrefetcher<Float_t>  TFloatWaveformPrefetcher;
+typedef TTemplWaveformPrefetcher<Int_t>    TIntWaveformPrefetcher;
+typedef TTemplWaveformPrefetcher<UShort_t> TUShortWaveformPrefetcher;
+typedef TTemplWaveformPrefetcher<Short_t>  TShortWaveformPrefetcher;
+
+#endif /* WAVE_TTemplWaveformPrefetcher_hh */
@@ -0,0 +1,287 @@
+#include "TTemplWaveformTree.hh"
+#include "TTree.h"
+#include "TBranch.h"
+#include <string>
+//______________________________________________________________________________
+//
+//  TTemplWaveformTreeWriter, TTemplWaveformTreeReader
+//
+//  Columnar storage of waveform collections in a TTree.  Instead of
+//  streaming every TTemplWaveform as a TObject, the writer splits each entry
+//  into the following branches:
+//
+//    channel/I            channel id
+//    freq/D               sampling frequency (CLHEP units)
+//    toffset/D            time offset (CLHEP units)
+//    nvalues/I            number of stored values
+//    samples[nvalues]/X   the raw samples, X the leaf type of the waveform
+//
+//  Each branch is compressed on its own, so the slowly-varying metadata
+//  compresses to almost nothing and the samples can use a different
+//  algorithm/level.  Complex waveforms (TWaveformFT) are stored as
+//  interleaved (real, imag) pairs, i.e. nvalues = 2*length.
+//
+//  Writing (the tree is created in the current directory, as usual in ROOT):
+//
+//    TFile afile("out.root", "recreate");
+//    TShortWaveformTreeWriter writer;
+//    writer.SetCompression(4, 1); // lz4, level 1
+//    for (...) writer.Fill(wf, channel);
+//    writer.Write();
+//
+//  Reading:
+//
+//    TShortWaveformTreeReader reader((TTree*)afile.Get("wfTree"));
+//    reader.SetCacheSize(64*1024*1024);
+//    std::vector<TShortWaveform> batch;
+//    for (Long64_t i=0; i<reader.GetEntries(); i+=1000) {
+//      size_t n = reader.ReadBatch(i, 1000, batch);
+//      ...
+//    }
+//
+//  Samples are read directly into the storage of the waveform, there is no
+//  intermediate copy.  ReadBatch() reuses the waveforms passed in so that
+//  repeated batches do not reallocate.
+//______________________________________________________________________________
+
+namespace {
+  template<typename _Tp> struct TreeTraits;
+  template<> struct TreeTraits<Double_t> { static char Leaf() { return 'D'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<Float_t>  { static char Leaf() { return 'F'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<Int_t>    { static char Leaf() { return 'I'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<UInt_t>   { static char Leaf() { return 'i'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<Short_t>  { static char Leaf() { return 'S'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<UShort_t> { static char Leaf() { return 's'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<Char_t>   { static char Leaf() { return 'B'; } static Int_t Values() { return 1; } };
+  template<> struct TreeTraits<std::complex<double> >
+                                          { static char Leaf() { return 'D'; } static Int_t Values() { return 2; } };
+
+  // Address used for zero-length waveforms, never written to.
+  double gEmptyBuffer[2];
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+TTemplWaveformTreeWriter<_Tp>::TTemplWaveformTreeWriter(const char* treeName,
+                                                        const char* treeTitle) :
+  fTree(new TTree(treeName, treeTitle)),
+  fChannel(0),
+  fSampleFreq(0.0),
+  fTOffset(0.0),
+  fNValues(0),
+  fSamplesBranch(NULL)
+{
+  // The tree is created in (and owned by) the current directory.
+  fTree->Branch("channel", &fChannel, "channel/I");
+  fTree->Branch("freq", &fSampleFreq, "freq/D");
+  fTree->Branch("toffset", &fTOffset, "toffset/D");
+  fTree->Branch("nvalues", &fNValues, "nvalues/I");
+  std::string leaflist = "samples[nvalues]/";
+  leaflist += TreeTraits<_Tp>::Leaf();
+  fSamplesBranch = fTree->Branch("samples", gEmptyBuffer, leaflist.c_str());
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformTreeWriter<_Tp>::SetCompression(Int_t algorithm, Int_t level)
+{
+  // Set the compression algorithm and level of all branches.  This uses the
+  // ROOT encoding, algorithm*100 + level.
+  TObjArray* branches = fTree->GetListOfBranches();
+  for (Int_t i=0;i<branches->GetEntriesFast();i++) {
+    static_cast<TBranch*>(branches->UncheckedAt(i))->SetCompressionSettings(100*algorithm + level);
+  }
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformTreeWriter<_Tp>::SetBasketSize(Int_t bytes)
+{
+  // Set the basket size of the samples branch.  Larger baskets compress
+  // better and are read in fewer calls.
+  fSamplesBranch->SetBasketSize(bytes);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformTreeWriter<_Tp>::SetAutoFlush(Long64_t entries)
+{
+  // Set the number of entries per cluster (see TTree::SetAutoFlush).
+  fTree->SetAutoFlush(entries);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Int_t TTemplWaveformTreeWriter<_Tp>::Fill(const TTemplWaveform<_Tp>& wf, Int_t channel)
+{
+  // Add a waveform to the tree, returns the number of bytes filled.
+  fChannel = channel;
+  fSampleFreq = wf.GetSamplingFreq();
+  fTOffset = wf.GetTOffset();
+  fNValues = static_cast<Int_t>(wf.GetLength())*TreeTraits<_Tp>::Values();
+  void* data = (wf.GetLength() > 0) ?
+    static_cast<void*>(const_cast<_Tp*>(wf.GetData())) : gEmptyBuffer;
+  fSamplesBranch->SetAddress(data);
+  return fTree->Fill();
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Int_t TTemplWaveformTreeWriter<_Tp>::Write(const char* name)
+{
+  // Write the tree to its directory.
+  return fTree->Write(name);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+TTemplWaveformTreeReader<_Tp>::TTemplWaveformTreeReader(TTree* tree) :
+  fTree(tree),
+  fTreeNumber(-1),
+  fLocalEntry(-1),
+  fChannel(0),
+  fSampleFreq(0.0),
+  fTOffset(0.0),
+  fNValues(0),
+  fChannelBranch(NULL),
+  fFreqBranch(NULL),
+  fTOffsetBranch(NULL),
+  fNValuesBranch(NULL),
+  fSamplesBranch(NULL)
+{
+  if (fTree == NULL) {
+    std::cerr << "Tree is NULL" << std::endl;
+    return;
+  }
+  if (!SetBranches()) fTree = NULL;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Bool_t TTemplWaveformTreeReader<_Tp>::SetBranches()
+{
+  // Get the branches of the current tree and set their addresses.  For a
+  // TChain the branches belong to one tree of the chain, so this is redone
+  // whenever LoadTree moves to another tree.
+  fChannelBranch = fTree->GetBranch("channel");
+  fFreqBranch    = fTree->GetBranch("freq");
+  fTOffsetBranch = fTree->GetBranch("toffset");
+  fNValuesBranch = fTree->GetBranch("nvalues");
+  fSamplesBranch = fTree->GetBranch("samples");
+  if (!fChannelBranch || !fFreqBranch || !fTOffsetBranch ||
+      !fNValuesBranch || !fSamplesBranch) {
+    std::cerr << "Tree does not contain waveform branches" << std::endl;
+    return false;
+  }
+  fChannelBranch->SetAddress(&fChannel);
+  fFreqBranch->SetAddress(&fSampleFreq);
+  fTOffsetBranch->SetAddress(&fTOffset);
+  fNValuesBranch->SetAddress(&fNValues);
+  fTreeNumber = fTree->GetTreeNumber();
+  return true;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Long64_t TTemplWaveformTreeReader<_Tp>::GetEntries() const
+{
+  return (fTree) ? fTree->GetEntries() : 0;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformTreeReader<_Tp>::SetCacheSize(Long64_t bytes)
+{
+  // Enable the TTreeCache for all waveform branches.  Baskets are then
+  // fetched cluster by cluster in single large reads.
+  if (!fTree) return;
+  fTree->SetCacheSize(bytes);
+  fTree->AddBranchToCache("*", kTRUE);
+  fTree->StopCacheLearningPhase();
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Bool_t TTemplWaveformTreeReader<_Tp>::GetMetadata(Long64_t entry)
+{
+  // Read the channel, frequency and time offset of entry.  Returns false if
+  // the entry does not exist.
+  if (!fTree || entry < 0 || entry >= fTree->GetEntries()) return false;
+  // For a TChain, entry is global and the branches read the local entry
+  fLocalEntry = fTree->LoadTree(entry);
+  if (fLocalEntry < 0) return false;
+  if (fTree->GetTreeNumber() != fTreeNumber && !SetBranches()) return false;
+  fChannelBranch->GetEntry(fLocalEntry);
+  fFreqBranch->GetEntry(fLocalEntry);
+  fTOffsetBranch->GetEntry(fLocalEntry);
+  return true;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+void TTemplWaveformTreeReader<_Tp>::ReadSamples(TTemplWaveform<_Tp>& wf)
+{
+  // Read the samples of the entry loaded by GetMetadata directly into the
+  // storage of wf.  The count branch has to be read first so that wf can be
+  // sized.
+  fNValuesBranch->GetEntry(fLocalEntry);
+  wf.SetLength(fNValues/TreeTraits<_Tp>::Values());
+  void* data = (wf.GetLength() > 0) ? static_cast<void*>(wf.GetData()) : gEmptyBuffer;
+  fSamplesBranch->SetAddress(data);
+  fSamplesBranch->GetEntry(fLocalEntry);
+  wf.SetSamplingFreq(fSampleFreq);
+  wf.SetTOffset(fTOffset);
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+Bool_t TTemplWaveformTreeReader<_Tp>::GetEntry(Long64_t entry, TTemplWaveform<_Tp>& wf)
+{
+  // Read entry into wf.  Returns false if the entry does not exist.
+  if (!GetMetadata(entry)) return false;
+  ReadSamples(wf);
+  return true;
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+size_t TTemplWaveformTreeReader<_Tp>::ReadBatch(Long64_t first, size_t number,
+                                                std::vector<TTemplWaveform<_Tp> >& wfs)
+{
+  // Read up to number entries beginning with first into wfs, returning the
+  // number of entries read.  wfs is only grown, never shrunk, so the
+  // waveforms (and their buffers) are reused between calls.  The cache entry
+  // range is restricted to the batch so that only the needed clusters are
+  // prefetched.
+  if (!fTree || first < 0 || first >= fTree->GetEntries()) return 0;
+  Long64_t last = first + static_cast<Long64_t>(number);
+  if (last > fTree->GetEntries()) last = fTree->GetEntries();
+  size_t n = static_cast<size_t>(last - first);
+  if (wfs.size() < n) wfs.resize(n);
+
+  fTree->SetCacheEntryRange(first, last);
+  for (size_t i=0;i<n;i++) {
+    if (!GetMetadata(first + i)) return i;
+    ReadSamples(wfs[i]);
+  }
+  return n;
+}
+
+//______________________________________________________________________________
+// The following are necessary to ensure that the above functions are generated.
+template class TTemplWaveformTreeWriter<Int_t>;
+template class TTemplWaveformTreeWriter<UInt_t>;
+template class TTemplWaveformTreeWriter<UShort_t>;
+template class TTemplWaveformTreeWriter<Short_t>;
+template class TTemplWaveformTreeWriter<Double_t>;
+template class TTemplWaveformTreeWriter<Float_t>;
+template class TTemplWaveformTreeWriter<Char_t>;
+template class TTemplWaveformTreeWriter<std::complex<double> >;
+template class TTemplWaveformTreeReader<Int_t>;
+template class TTemplWaveformTreeReader<UInt_t>;
+template class TTemplWaveformTreeReader<UShort_t>;
+template class TTemplWaveformTreeReader<Short_t>;
+template class TTemplWaveformTreeReader<Double_t>;
+template class TTemplWaveformTreeReader<Float_t>;
+template class TTemplWaveformTreeReader<Char_t>;
+template class TTemplWaveformTreeReader<std::complex<double> >;
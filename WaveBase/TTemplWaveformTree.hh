@@ -0,0 +1,123 @@
+/**
+ *
+ * CLASS DECLARATION:  TTemplWaveformTree.hh
+ *
+ * DESCRIPTION:
+ *
+ * Columnar TTree storage of waveform collections.  A writer and a reader
+ * which split the channel id, the timing metadata and the samples into
+ * separate branches.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TTemplWaveformTree_hh
+#define WAVE_TTemplWaveformTree_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+#include <vector>
+
+class TTree;
+class TBranch;
+
+template<typename _Tp>
+class TTemplWaveformTreeWriter
+{
+  public:
+    TTemplWaveformTreeWriter(const char* treeName = "wfTree",
+                             const char* treeTitle = "Waveforms");
+    virtual ~TTemplWaveformTreeWriter() {}
+
+    // Compression is given as in ROOT, e.g. algorithm 1 (zlib), 2 (lzma),
+    // 4 (lz4) and level 0-9.  Applies to all baskets written afterwards.
+    void SetCompression(Int_t algorithm, Int_t level);
+    void SetBasketSize(Int_t bytes);
+    void SetAutoFlush(Long64_t entries);
+
+    Int_t Fill(const TTemplWaveform<_Tp>& wf, Int_t channel = 0);
+    Int_t Write(const char* name = 0);
+
+    TTree* GetTree() { return fTree; }
+
+  protected:
+    TTree*   fTree;        // Output tree, owned by the current directory
+    Int_t    fChannel;     // Channel id of the current entry
+    Double_t fSampleFreq;  // Sampling frequency of the current entry
+    Double_t fTOffset;     // Time offset of the current entry
+    Int_t    fNValues;     // Number of stored values of the current entry
+    TBranch* fSamplesBranch;
+
+  private:
+    TTemplWaveformTreeWriter(const TTemplWaveformTreeWriter<_Tp>&);
+    TTemplWaveformTreeWriter<_Tp>& operator=(const TTemplWaveformTreeWriter<_Tp>&);
+};
+
+template<typename _Tp>
+class TTemplWaveformTreeReader
+{
+  public:
+    TTemplWaveformTreeReader(TTree* tree);
+    virtual ~TTemplWaveformTreeReader() {}
+
+    Long64_t GetEntries() const;
+
+    // Enable the TTreeCache so that baskets are read in large, contiguous
+    // blocks.
+    void SetCacheSize(Long64_t bytes);
+
+    // Read only the metadata (channel, frequency, offset) of an entry.  The
+    // samples branch is not touched.
+    Bool_t GetMetadata(Long64_t entry);
+    Bool_t GetEntry(Long64_t entry, TTemplWaveform<_Tp>& wf);
+    size_t ReadBatch(Long64_t first, size_t number,
+                     std::vector<TTemplWaveform<_Tp> >& wfs);
+
+    Int_t    GetChannel() const { return fChannel; }
+    Double_t GetSamplingFreq() const { return fSampleFreq; }
+    Double_t GetTOffset() const { return fTOffset; }
+
+  protected:
+    Bool_t SetBranches();
+    // Read the samples of the entry loaded by GetMetadata
+    void ReadSamples(TTemplWaveform<_Tp>& wf);
+
+    TTree*   fTree;
+    Int_t    fTreeNumber;  // tree of a TChain the branches belong to
+    Long64_t fLocalEntry;  // entry in that tree
+    Int_t    fChannel;
+    Double_t fSampleFreq;
+    Double_t fTOffset;
+    Int_t    fNValues;
+    TBranch* fChannelBranch;
+    TBranch* fFreqBranch;
+    TBranch* fTOffsetBranch;
+    TBranch* fNValuesBranch;
+    TBranch* fSamplesBranch;
+
+  private:
+    TTemplWaveformTreeReader(const TTemplWaveformTreeReader<_Tp>&);
+    TTemplWaveformTreeReader<_Tp>& operator=(const TTemplWaveformTreeReader<_Tp>&);
+};
+
+typedef TTemplWaveformTreeWriter<Double_t> TDoubleWaveformTreeWriter;
+typedef TTemplWaveformTreeWriter<Float_t>  TFloatWaveformTreeWriter;
+typedef TTemplWaveformTreeWriter<Int_t>    TIntWaveformTreeWriter;
+typedef TTemplWaveformTreeWriter<UShort_t> TUShortWaveformTreeWriter;
+typedef TTemplWaveformTreeWriter<Short_t>  TShortWaveformTreeWriter;
+typedef TTemplWaveformTreeWriter<std::complex<double> > TWaveformFTTreeWriter;
+
+typedef TTemplWaveformTreeReader<Double_t> TDoubleWaveformTreeReader;
+typedef TTemplWaveformTreeReader<Float_t>  TFloatWaveformTreeReader;
+typedef TTemplWaveformTreeReader<Int_t>    TIntWaveformTreeReader;
+typedef TTemplWaveformTreeReader<UShort_t> TUShortWaveformTreeReader;
+typedef TTemplWaveformTreeReader<Short_t>  TShortWaveformTreeReader;
+typedef TTemplWaveformTreeReader<std::complex<double> > TWaveformFTTreeReader;
+
+#endif /* WAVE_TTemplWaveformTree_hh */
@@ -0,0 +1,104 @@
+/**
+ *
+ * CLASS DECLARATION:  TTemplWaveformView.hh
+ *
+ * DESCRIPTION:
+ *
+ * Non-owning, read-only view of waveform samples held elsewhere (e.g. in a
+ * memory mapped file).  Offers the read accessors of TTemplWaveform.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TTemplWaveformView_hh
+#define WAVE_TTemplWaveformView_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+#include <stdexcept>
+
+template<typename _Tp>
+class TTemplWaveformView
+{
+  public:
+    TTemplWaveformView() : fData(NULL), fLength(0),
+      fSampleFreq(CLHEP::megahertz), fTOffset(0.0) {}
+    TTemplWaveformView(const _Tp* aData, size_t length,
+                       double freq = CLHEP::megahertz, double toffset = 0.0) :
+      fData(aData), fLength(length), fSampleFreq(freq), fTOffset(toffset) {}
+    TTemplWaveformView(const TTemplWaveform<_Tp>& wf) :
+      fData(wf.GetData()), fLength(wf.GetLength()),
+      fSampleFreq(wf.GetSamplingFreq()), fTOffset(wf.GetTOffset()) {}
+
+    void Set(const _Tp* aData, size_t length, double freq, double toffset)
+    {
+      // Point the view at new data
+      fData = aData;
+      fLength = length;
+      fSampleFreq = freq;
+      fTOffset = toffset;
+    }
+
+    const _Tp* GetData() const { return fData; }
+    size_t GetLength() const { return fLength; }
+    size_t size() const { return fLength; }
+
+    _Tp At(size_t i) const
+    {
+      // Bounds-checked access, throws like TTemplWaveform::At
+      if (i >= fLength) throw std::out_of_range("TTemplWaveformView::At");
+      return fData[i];
+    }
+    const _Tp& operator[](size_t i) const { return fData[i]; }
+
+    Double_t GetSamplingFreq() const { return fSampleFreq; }
+    Double_t GetSamplingPeriod() const { return 1./fSampleFreq; }
+    Double_t GetTOffset() const { return fTOffset; }
+    Double_t GetTimeAtIndex(size_t Index) const
+    {
+      // Time of the element at Index, no range check
+      return Index/fSampleFreq + fTOffset;
+    }
+
+    _Tp Sum(size_t start = 0, size_t stop = (size_t)-1) const
+    {
+      // Sum of [start, stop), see TTemplWaveform::Sum
+      if (stop > fLength) stop = fLength;
+      _Tp temp(0);
+      for (size_t i=start;i<stop;i++) temp += fData[i];
+      return temp;
+    }
+
+    void CopyTo(TTemplWaveform<_Tp>& wf) const
+    {
+      // Copy into an owning waveform
+      wf.SetData(fData, fLength);
+      wf.SetSamplingFreq(fSampleFreq);
+      wf.SetTOffset(fTOffset);
+    }
+
+    typedef const _Tp* CIter;
+    CIter begin() const { return fData; }
+    CIter end()   const { return fData + fLength; }
+
+  protected:
+    const _Tp* fData;       // Viewed data, not owned
+    size_t     fLength;     // Number of samples
+    Double_t   fSampleFreq; // Sampling frequency
+    Double_t   fTOffset;    // Time offset
+};
+
+typedef TTemplWaveformView<Double_t> TDoubleWaveformView;
+typedef TTemplWaveformView<Float_t>  TFloatWaveformView;
+typedef TTemplWaveformView<Int_t>    TIntWaveformView;
+typedef TTemplWaveformView<UShort_t> TUShortWaveformView;
+typedef TTemplWaveformView<Short_t>  TShortWaveformView;
+typedef TTemplWaveformView<std::complex<double> > TWaveformFTView;
+
+#endif /* WAVE_TTemplWaveformView_hh */
@@ -0,0 +1,115 @@
+#include "TTrapezoidalFilter.hh"
+#include "TMath.h"
+#include <algorithm>
+
+//______________________________________________________________________________
+// TTrapezoidalFilter
+// 
+//   Trapezoidal shaping of exponentially decaying pulses (V. T. Jordanov and
+//   G. F. Knoll, NIM A 345 (1994) 337), which is the same as a moving window
+//   deconvolution.  With k rise and m flat-top samples, l = k + m, and
+//   M = 1/(exp(T/tau) - 1) for sampling period T and decay time tau:
+//
+//     d[n] = v[n] - v[n-k] - v[n-l] + v[n-k-l]
+//     p[n] = p[n-1] + d[n]
+//     r[n] = p[n] + M*d[n]
+//     s[n] = s[n-1] + r[n]
+//
+//   s is divided by k*(M+1), so that a pulse of amplitude A gives a flat top
+//   of height A.  The cost is O(N) independently of the shaping times.
+//   Samples before the start of the waveform are taken equal to the first
+//   sample, so that a constant baseline produces no output at all.
+//
+//   TransformBatch() runs fBatchWidth waveforms in lock-step, one per SIMD
+//   lane.
+//
+
+namespace {
+  template<size_t W>
+  void TrapezoidLanes(double* block, size_t width, size_t n, 
+                      size_t rise, size_t gap, double M, double norm)
+  {
+    // block holds gap + n rows of width lanes: gap rows of history followed
+    // by the input.  Row i receives the output of sample i, rows are
+    // consumed before being overwritten.  W is the number of lanes when
+    // known at compile time (0: use width).
+    const size_t nl = (W > 0) ? W : width;
+    const size_t D = rise + gap;
+    double p[W > 0 ? W : 16], s[W > 0 ? W : 16];
+    for (size_t l=0;l<nl;l++) p[l] = s[l] = 0.0;
+    for (size_t i=0;i<n;i++) {
+      const double* v0 = block + (i + D)*nl;
+      const double* vk = block + (i + D - rise)*nl;
+      const double* vl = block + (i + D - gap)*nl;
+      double* vkl = block + i*nl;
+      for (size_t l=0;l<nl;l++) {
+        double d = v0[l] - vk[l] - vl[l] + vkl[l];
+        p[l] += d;
+        s[l] += p[l] + M*d;
+        vkl[l] = s[l]*norm;
+      }
+    }
+  }
+}
+
+void TTrapezoidalFilter::GetParameters(double samplingFreq, size_t& rise, 
+                                       size_t& gap, double& M) const
+{
+  // Parameters in samples for a sampling frequency, rise is at least 1.
+  rise = (size_t)TMath::Max(1, TMath::Nint(fRiseTime*samplingFreq));
+  gap = rise + (size_t)TMath::Max(0, TMath::Nint(fFlatTop*samplingFreq));
+  M = (fDecayTime > 0) ? 1./(TMath::Exp(1./(fDecayTime*samplingFreq)) - 1) : 0.;
+}
+
+void TTrapezoidalFilter::TransformInPlace(TDoubleWaveform& input) const
+{
+  const size_t n = input.GetLength();
+  if (n == 0) return;
+  size_t rise, gap;
+  double M;
+  GetParameters(input.GetSamplingFreq(), rise, gap, M);
+  const size_t D = rise + gap;
+
+  fHistory.resize(D + n);
+  std::fill(fHistory.begin(), fHistory.begin() + D, input[0]);
+  std::copy(input.GetData(), input.GetData() + n, fHistory.begin() + D);
+  TrapezoidLanes<1>(&fHistory[0], 1, n, rise, gap, M, 1./(rise*(M + 1)));
+  std::copy(fHistory.begin(), fHistory.begin() + n, input.GetData());
+}
+
+void TTrapezoidalFilter::TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const
+{
+  // All waveforms of a batch must have the same sampling frequency, since
+  // the filter parameters are computed once per batch.
+  if (waveforms.empty()) return;
+  const double freq = waveforms[0]->GetSamplingFreq();
+  for (size_t i=1;i<waveforms.size();i++) {
+    if (waveforms[i]->GetSamplingFreq() != freq) {
+      TWaveformDiagnostics::Report(TWaveformDiagnostics::kFrequencyMismatch,
+        "Waveforms in batch have different sampling frequencies");
+      return;
+    }
+  }
+  size_t rise, gap;
+  double M;
+  GetParameters(freq, rise, gap, M);
+  const size_t D = rise + gap;
+  const double norm = 1./(rise*(M + 1));
+
+  const size_t W = fBatchWidth;
+  for (size_t first=0;first<waveforms.size();first+=W) {
+    size_t length = GetMaxLength(waveforms, first, W);
+    if (length == 0) continue;
+    // The full traces are transposed, behind D rows of history.
+    fHistory.resize((D + length)*W);
+    double* block = &fHistory[0];
+    GatherLanes(waveforms, first, W, 0, length, block + D*W);
+    for (size_t i=0;i<D;i++) std::copy(block + D*W, block + (D+1)*W, block + i*W);
+    switch (W) {
+      case 4:  TrapezoidLanes<4>(block, W, length, rise, gap, M, norm); break;
+      case 16: TrapezoidLanes<16>(block, W, length, rise, gap, M, norm); break;
+      default: TrapezoidLanes<8>(block, W, length, rise, gap, M, norm); break;
+    }
+    ScatterLanes(waveforms, first, W, 0, length, block);
+  }
+}
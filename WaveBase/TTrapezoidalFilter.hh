@@ -0,0 +1,54 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TTrapezoidalFilter.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Recursive trapezoidal (moving window deconvolution) energy filter with
+ * pole-zero correction.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TTrapezoidalFilter_hh
+#define WAVE_TTrapezoidalFilter_hh
+
+#ifndef WAVE_TVWaveformTransformer_hh
+#include "TVWaveformTransformer.hh" 
+#endif
+
+class TTrapezoidalFilter : public TVWaveformTransformer
+{
+  public:
+    TTrapezoidalFilter() : TVWaveformTransformer("TTrapezoidalFilter"), 
+      fRiseTime(1.*CLHEP::microsecond), fFlatTop(1.*CLHEP::microsecond), 
+      fDecayTime(0.) {}
+  
+    virtual bool IsInPlace() const { return true; }
+
+    // Times in CLHEP units, rounded to samples of the transformed waveform.
+    // A decay time <= 0 disables the pole-zero correction (step input).
+    void SetRiseTime(double rise) { fRiseTime = rise; }
+    void SetFlatTop(double flat) { fFlatTop = flat; }
+    void SetDecayTime(double tau) { fDecayTime = tau; }
+    double GetRiseTime() const { return fRiseTime; }
+    double GetFlatTop() const { return fFlatTop; }
+    double GetDecayTime() const { return fDecayTime; }
+    
+  protected:
+    virtual void TransformInPlace(TDoubleWaveform& input) const;
+    virtual void TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const;
+    void GetParameters(double samplingFreq, size_t& rise, size_t& gap, double& M) const;
+
+    double fRiseTime;
+    double fFlatTop;
+    double fDecayTime;
+    mutable std::vector<double> fHistory; // input delayed by rise + flat top 
+};
+
+#endif /* WAVE_TTrapezoidalFilter_hh */
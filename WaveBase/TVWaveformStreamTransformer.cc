@@ -0,0 +1,65 @@
+#include "TVWaveformStreamTransformer.hh"
+
+//______________________________________________________________________________
+// TVWaveformStreamTransformer
+// 
+// Abstract class for processing a long trace in fixed-size chunks, so that
+// memory use is bounded however long the trace is.  Derived classes carry
+// the state they need from one chunk to the next (the last output of a
+// recursion, the overlap of an FFT filter, ...).
+//
+// Usage:
+//
+//   TExpWindowAverageStream avg;
+//   avg.Reset();
+//   while (reader.NextChunk(chunk)) {
+//     avg.Process(chunk, out);
+//     ... use out ...
+//   }
+//   avg.Finish(out);
+//
+// The base class takes care of the timing: every output waveform has the
+// sampling frequency of the stream and the time offset of its first sample,
+// so consecutive outputs can be appended to give the full result.
+//
+// To derive from this class, implement ResetState() and ProcessChunk(), and
+// FinishStream() if the transformation buffers samples.  Several stages can
+// be run in sequence with TWaveformStreamChain.
+
+void TVWaveformStreamTransformer::Reset()
+{
+  fStarted = false;
+  fNextTOffset = 0.0;
+  ResetState();
+}
+
+void TVWaveformStreamTransformer::Process(const TDoubleWaveform& chunk, TDoubleWaveform& output)
+{
+  if (!fStarted) {
+    fStarted = true;
+    fNextTOffset = chunk.GetTOffset();
+    fSampleFreq = chunk.GetSamplingFreq();
+  } else if (chunk.GetSamplingFreq() != fSampleFreq) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kFrequencyMismatch,
+      "Chunk frequency does not match the stream");
+    output.SetLength(0);
+    return;
+  }
+  output.SetLength(0);
+  ProcessChunk(chunk, output);
+  StampOutput(output);
+}
+
+void TVWaveformStreamTransformer::Finish(TDoubleWaveform& output)
+{
+  output.SetLength(0);
+  if (fStarted) FinishStream(output);
+  StampOutput(output);
+}
+
+void TVWaveformStreamTransformer::StampOutput(TDoubleWaveform& output)
+{
+  output.SetSamplingFreq(fSampleFreq);
+  output.SetTOffset(fNextTOffset);
+  fNextTOffset += output.GetLength()/fSampleFreq;
+}
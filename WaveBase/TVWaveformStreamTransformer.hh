@@ -0,0 +1,64 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TVWaveformStreamTransformer.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Abstract class handling chunk-wise (streaming) processing of arbitrarily
+ * long waveforms, with state carried across chunk boundaries.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TVWaveformStreamTransformer_hh
+#define WAVE_TVWaveformStreamTransformer_hh
+
+#include <string> 
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh" 
+#endif
+
+class TVWaveformStreamTransformer
+{
+  public:
+    virtual ~TVWaveformStreamTransformer() { }
+
+    // Start a new trace, forgetting all state.
+    void Reset();
+    // Feed the next chunk of the trace.  output is overwritten with the
+    // samples that are ready, which may be fewer or more than the chunk.
+    void Process(const TDoubleWaveform& chunk, TDoubleWaveform& output);
+    // End of the trace, output receives all remaining samples.
+    void Finish(TDoubleWaveform& output);
+
+    const std::string& GetStringName() const { return fName; }
+    const char* GetName() const { return fName.c_str(); }
+
+  protected:
+    TVWaveformStreamTransformer( const std::string& aTransformationName ) :
+      fName(aTransformationName), fStarted(false), fNextTOffset(0.0),
+      fSampleFreq(CLHEP::megahertz)
+      { } 
+
+    // Derived classes implement these, output has already been emptied and
+    // its timing is set by the base class.
+    virtual void ResetState() = 0;
+    virtual void ProcessChunk(const TDoubleWaveform& chunk, TDoubleWaveform& output) = 0;
+    virtual void FinishStream(TDoubleWaveform& /*output*/) {}
+
+  private:
+    TVWaveformStreamTransformer();
+    void StampOutput(TDoubleWaveform& output);
+
+    std::string fName;        // Name of the transformation class.
+    bool        fStarted;     // Has the first chunk been seen
+    double      fNextTOffset; // Time of the next sample to be emitted
+    double      fSampleFreq;  // Sampling frequency of the stream
+};
+
+#endif /* WAVE_TVWaveformStreamTransformer_hh */
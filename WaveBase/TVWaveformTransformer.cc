@@ -1,5 +1,6 @@
 #include "TVWaveformTransformer.hh"
 #include <cassert>
+#include <algorithm>
 
 //______________________________________________________________________________
 // TVWaveformTransformer
@@ -19,6 +20,9 @@
 // latter, the most efficient is to implement a function that contains the same
 // algorithm and have both TransformInPlace and TransformOutOfPlace call this
 // function. 
+//
+// Calls, samples and time of Transform and TransformBatch are counted per
+// name by TWaveformProfiler.
 
 void TVWaveformTransformer::Transform(TDoubleWaveform* input, TDoubleWaveform* output) const 
 {
@@ -35,10 +39,13 @@ void TVWaveformTransformer::Transform(TDoubleWaveform* input, TDoubleWaveform* o
   // the base class so that the derived classes don't need to.
 
   if(input == NULL) {
-    std::cerr << "input is NULL." << std::endl;
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kNullInput, "input is NULL.");
     return;
   }
 
+  const ULong64_t start = TWaveformProfiler::IsEnabled() ? 
+    TWaveformProfiler::Start(GetCounters(), 1, input->GetLength()) : 0;
+
   // If an output waveform was given, then clearly the user wants an out-of-place transform.
   // In case the appropriate function is not defined in the derived class, the base versions
   // will do the right thing.
@@ -47,6 +54,15 @@ void TVWaveformTransformer::Transform(TDoubleWaveform* input, TDoubleWaveform* o
     output->MakeSimilarTo(*input);
     TransformOutOfPlace(*input, *output);
   }
+
+  if(start != 0) TWaveformProfiler::Stop(fCounters, start);
+}
+
+TWaveformProfiler::CounterId TVWaveformTransformer::GetCounters() const
+{
+  // Profiling counters of this transformer's name.
+  if(fCounters == 0) fCounters = TWaveformProfiler::GetTransformerCounters(fName);
+  return fCounters;
 }
 
 void TVWaveformTransformer::TransformInPlace(TDoubleWaveform& input) const
@@ -77,3 +93,81 @@ void TVWaveformTransformer::TransformOutOfPlace(const TDoubleWaveform& input, TD
   output = input;
   TransformInPlace(output);
 }
+
+void TVWaveformTransformer::SetBatchWidth(size_t width)
+{
+  // Set the number of channels processed in lock-step by TransformBatch,
+  // i.e. the vector width of the recursion.
+  if (width != 4 && width != 8 && width != 16) {
+    std::cerr << "Batch width must be 4, 8 or 16" << std::endl;
+    return;
+  }
+  fBatchWidth = width;
+}
+
+void TVWaveformTransformer::TransformBatch(const std::vector<TDoubleWaveform*>& waveforms) const
+{
+  // Transform all waveforms in place.  Equivalent to calling Transform() on
+  // each of them, but derived classes with a sequential recursion (where
+  // sample i depends on sample i-1, so that nothing can be vectorized along
+  // time) process fBatchWidth waveforms at once, one per SIMD lane.
+  for (size_t i=0;i<waveforms.size();i++) {
+    if (waveforms[i] == NULL) {
+      TWaveformDiagnostics::Report(TWaveformDiagnostics::kNullInput, "input is NULL.");
+      return;
+    }
+  }
+  ULong64_t start = 0;
+  if (TWaveformProfiler::IsEnabled()) {
+    size_t samples = 0;
+    for (size_t i=0;i<waveforms.size();i++) samples += waveforms[i]->GetLength();
+    start = TWaveformProfiler::Start(GetCounters(), waveforms.size(), samples);
+  }
+  TransformBatchInPlace(waveforms);
+  if (start != 0) TWaveformProfiler::Stop(fCounters, start, waveforms.size());
+}
+
+void TVWaveformTransformer::TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const
+{
+  // Default: one waveform after the other.
+  for (size_t i=0;i<waveforms.size();i++) TransformInPlace(*waveforms[i]);
+}
+
+size_t TVWaveformTransformer::GetMaxLength(const std::vector<TDoubleWaveform*>& waveforms, 
+                                           size_t first, size_t width)
+{
+  size_t length = 0;
+  for (size_t lane=0;lane<width && first+lane<waveforms.size();lane++) {
+    if (waveforms[first+lane]->GetLength() > length) length = waveforms[first+lane]->GetLength();
+  }
+  return length;
+}
+
+void TVWaveformTransformer::GatherLanes(const std::vector<TDoubleWaveform*>& waveforms, 
+                                        size_t first, size_t width, size_t start, size_t n, 
+                                        double* block)
+{
+  for (size_t lane=0;lane<width;lane++) {
+    size_t m = 0;
+    if (first+lane < waveforms.size()) {
+      const TDoubleWaveform& wf = *waveforms[first+lane];
+      if (start < wf.GetLength()) m = std::min(n, wf.GetLength() - start);
+      const double* data = wf.GetData() + start;
+      for (size_t i=0;i<m;i++) block[i*width + lane] = data[i];
+    }
+    for (size_t i=m;i<n;i++) block[i*width + lane] = 0.0;
+  }
+}
+
+void TVWaveformTransformer::ScatterLanes(const std::vector<TDoubleWaveform*>& waveforms, 
+                                         size_t first, size_t width, size_t start, size_t n, 
+                                         const double* block)
+{
+  for (size_t lane=0;lane<width && first+lane<waveforms.size();lane++) {
+    TDoubleWaveform& wf = *waveforms[first+lane];
+    if (start >= wf.GetLength()) continue;
+    size_t m = std::min(n, wf.GetLength() - start);
+    double* data = wf.GetData() + start;
+    for (size_t i=0;i<m;i++) data[i] = block[i*width + lane];
+  }
+}
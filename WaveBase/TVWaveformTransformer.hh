@@ -18,9 +18,11 @@
 #define WAVE_TVWaveformTransformer_hh
 
 #include <string> 
+#include <vector> 
 #ifndef WAVE_TTemplWaveform_hh
 #include "TTemplWaveform.hh" 
 #endif
+#include "TWaveformProfiler.hh"
 
 class TVWaveformTransformer
 {
@@ -33,22 +35,48 @@ class TVWaveformTransformer
     virtual bool IsOutOfPlace() const { return !IsInPlace(); }
 
     virtual void Transform(TDoubleWaveform* input, TDoubleWaveform* output = NULL) const;
+
+    // Transform several waveforms in place.  Recursive filters override
+    // TransformBatchInPlace() to run fBatchWidth channels in lock-step.
+    void TransformBatch(const std::vector<TDoubleWaveform*>& waveforms) const;
+    // Number of channels processed together, 4, 8 or 16.
+    void SetBatchWidth(size_t width);
+    size_t GetBatchWidth() const { return fBatchWidth; }
     const std::string& GetStringName() const { return fName; }
     const char* GetName() const { return fName.c_str(); }
     
   protected:
    TVWaveformTransformer( const std::string& aTransformationName ) :
-      fName(aTransformationName)
+      fBatchWidth(8), fName(aTransformationName), fCounters(0)
       { } 
 
     virtual void TransformInPlace(TDoubleWaveform& input) const;
     virtual void TransformOutOfPlace(const TDoubleWaveform& input, TDoubleWaveform& output) const;
+    virtual void TransformBatchInPlace(const std::vector<TDoubleWaveform*>& waveforms) const;
+
+    // Transposition of samples [start, start+n) of waveforms [first,
+    // first+width) to/from block[i*width + lane], for batched recursions.
+    // Lanes past the end of a waveform read 0 and are not written back.
+    static void GatherLanes(const std::vector<TDoubleWaveform*>& waveforms, size_t first,
+                            size_t width, size_t start, size_t n, double* block);
+    static void ScatterLanes(const std::vector<TDoubleWaveform*>& waveforms, size_t first,
+                             size_t width, size_t start, size_t n, const double* block);
+    static size_t GetMaxLength(const std::vector<TDoubleWaveform*>& waveforms, size_t first,
+                               size_t width);
+
+    enum { kLaneBlockLength = 256 }; // samples per transposed block
+
+    size_t fBatchWidth;
+    mutable std::vector<double> fLaneBlock; // transposed block, see GatherLanes
   
   private:
     // Make the default constructor private to force usage of the other constructor.
     TVWaveformTransformer();
 
     std::string fName; // Name of the transformation class.
+    // Counters of fName in TWaveformProfiler, looked up on first use.
+    mutable TWaveformProfiler::CounterId fCounters; //! 
+    TWaveformProfiler::CounterId GetCounters() const;
     mutable TDoubleWaveform fTmpWaveform; // Temporary waveform, use only by base class. 
 };
 
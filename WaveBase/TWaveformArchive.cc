@@ -0,0 +1,251 @@
+#include "TWaveformArchive.hh"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+//______________________________________________________________________________
+//
+//  TWaveformArchive, TWaveformArchiveWriter
+//
+//  A flat binary format for fast re-processing of waveforms, bypassing the
+//  ROOT streamers completely.  The layout of the file is:
+//
+//    header      magic "TWFARCH", version, index record size, number of
+//                entries, byte offset of the index (32 bytes)
+//    samples     raw sample blocks, each starting on a 64-byte boundary
+//    index       one TWaveformArchive::Entry per waveform: offset, length,
+//                sampling frequency, time offset and sample type, also on a
+//                64-byte boundary
+//
+//  The reader checks the header and every index entry against the size of
+//  the file, so that a truncated or corrupt archive is rejected on Open
+//  instead of handing out views past the end of the mapping.
+//
+//  Data are stored in the byte order of the writing machine.
+//
+//  Writing:
+//
+//    TWaveformArchiveWriter writer;
+//    writer.Open("run.wfa");
+//    for (...) writer.Add(wf);
+//    writer.Close();
+//
+//  Reading, the file is memory mapped so that opening is immediate and
+//  samples are never copied:
+//
+//    TWaveformArchive archive;
+//    archive.Open("run.wfa");
+//    TShortWaveformView view;
+//    for (size_t i=0;i<archive.GetEntries();i++) {
+//      if (!archive.GetView(i, view)) continue;
+//      ... view[j], view.GetLength(), view.GetTimeAtIndex(j) ...
+//    }
+//
+//  A view can be copied into an owning waveform with
+//  TTemplWaveformView::CopyTo() when it needs to be modified (e.g. by a
+//  TVWaveformTransformer).
+//______________________________________________________________________________
+
+namespace {
+  const char   kMagic[8] = { 'T', 'W', 'F', 'A', 'R', 'C', 'H', '\0' };
+  const UInt_t kVersion = 1;
+  const size_t kAlignment = 64;
+
+  struct Header {
+    char      fMagic[8];
+    UInt_t    fVersion;
+    UInt_t    fEntrySize;
+    ULong64_t fNEntries;
+    ULong64_t fIndexOffset;
+  };
+
+  // Bytes per sample of a TWaveformArchive::EType, 0 if unknown
+  size_t GetSampleSize(Int_t type)
+  {
+    switch (type) {
+      case TWaveformArchive::kDouble:  return sizeof(Double_t);
+      case TWaveformArchive::kFloat:   return sizeof(Float_t);
+      case TWaveformArchive::kInt:     return sizeof(Int_t);
+      case TWaveformArchive::kUShort:  return sizeof(UShort_t);
+      case TWaveformArchive::kShort:   return sizeof(Short_t);
+      case TWaveformArchive::kUInt:    return sizeof(UInt_t);
+      case TWaveformArchive::kChar:    return sizeof(Char_t);
+      case TWaveformArchive::kComplex: return 2*sizeof(Double_t);
+      default: return 0;
+    }
+  }
+}
+
+//______________________________________________________________________________
+bool TWaveformArchive::Open(const char* fileName)
+{
+  // Map the archive fileName.  Returns false (and logs) on failure.
+  Close();
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Unable to open " << fileName << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    std::cerr << fileName << " is not a waveform archive" << std::endl;
+    close(fd);
+    return false;
+  }
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Unable to map " << fileName << std::endl;
+    return false;
+  }
+  fMapping = mapping;
+  fMappedSize = st.st_size;
+
+  // Written so that a corrupt fNEntries cannot overflow the size check.
+  // The writer always aligns the index, which is then used in place.
+  const Header* header = static_cast<const Header*>(fMapping);
+  if (std::memcmp(header->fMagic, kMagic, sizeof(kMagic)) != 0 ||
+      header->fVersion != kVersion || header->fEntrySize != sizeof(Entry) ||
+      header->fIndexOffset < sizeof(Header) || header->fIndexOffset > fMappedSize ||
+      header->fIndexOffset % kAlignment != 0 ||
+      header->fNEntries > (fMappedSize - header->fIndexOffset)/sizeof(Entry)) {
+    std::cerr << fileName << " is not a valid waveform archive" << std::endl;
+    Close();
+    return false;
+  }
+  fIndex = reinterpret_cast<const Entry*>(static_cast<const char*>(fMapping) +
+                                          header->fIndexOffset);
+  fNEntries = static_cast<size_t>(header->fNEntries);
+  if (!CheckEntries(fileName)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+bool TWaveformArchive::CheckEntries(const char* fileName) const
+{
+  // Check that every entry has a known type and that its samples are
+  // aligned and lie inside the mapping, before any view is handed out.
+  for (size_t i=0;i<fNEntries;i++) {
+    const Entry& e = fIndex[i];
+    size_t sampleSize = GetSampleSize(e.fType);
+    if (sampleSize == 0 || e.fOffset < sizeof(Header) || e.fOffset > fMappedSize ||
+        e.fOffset % sampleSize != 0 ||
+        e.fLength > (fMappedSize - e.fOffset)/sampleSize) {
+      std::cerr << fileName << ": entry " << i << " is corrupt" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//______________________________________________________________________________
+void TWaveformArchive::Close()
+{
+  // Unmap the archive, invalidates all views.
+  if (fMapping != NULL) munmap(fMapping, fMappedSize);
+  fMapping = NULL;
+  fMappedSize = 0;
+  fIndex = NULL;
+  fNEntries = 0;
+}
+
+//______________________________________________________________________________
+void TWaveformArchive::WillNeed() const
+{
+  // Advise the kernel that the whole archive will be read, so that pages are
+  // read ahead.
+  if (fMapping != NULL) madvise(fMapping, fMappedSize, MADV_WILLNEED);
+}
+
+//______________________________________________________________________________
+bool TWaveformArchiveWriter::Open(const char* fileName)
+{
+  // Create (or overwrite) the archive fileName.
+  Close();
+  fFile = fopen(fileName, "wb");
+  if (fFile == NULL) {
+    std::cerr << "Unable to open " << fileName << std::endl;
+    return false;
+  }
+  // Placeholder header, rewritten in Close()
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  fwrite(&header, sizeof(header), 1, fFile);
+  fPosition = sizeof(header);
+  fIndex.clear();
+  return true;
+}
+
+//______________________________________________________________________________
+bool TWaveformArchiveWriter::AddBlock(const void* data, size_t length,
+                                      size_t sampleSize, Int_t type,
+                                      double freq, double toffset)
+{
+  if (fFile == NULL) {
+    std::cerr << "Archive not open" << std::endl;
+    return false;
+  }
+  // Pad so that the block starts on an aligned boundary
+  if (!Pad()) return false;
+
+  TWaveformArchive::Entry entry;
+  std::memset(&entry, 0, sizeof(entry));
+  entry.fOffset = fPosition;
+  entry.fLength = length;
+  entry.fSampleFreq = freq;
+  entry.fTOffset = toffset;
+  entry.fType = type;
+
+  size_t bytes = length*sampleSize;
+  if (bytes > 0 && fwrite(data, 1, bytes, fFile) != bytes) {
+    std::cerr << "Error writing archive" << std::endl;
+    return false;
+  }
+  fPosition += bytes;
+  fIndex.push_back(entry);
+  return true;
+}
+
+//______________________________________________________________________________
+bool TWaveformArchiveWriter::Pad()
+{
+  // Write zeros up to the next kAlignment boundary.
+  static const char padding[kAlignment] = { 0 };
+  size_t pad = (kAlignment - fPosition % kAlignment) % kAlignment;
+  if (pad > 0 && fwrite(padding, 1, pad, fFile) != pad) return false;
+  fPosition += pad;
+  return true;
+}
+
+//______________________________________________________________________________
+bool TWaveformArchiveWriter::Close()
+{
+  // Write the index and the final header, and close the file.
+  if (fFile == NULL) return false;
+  // The reader maps the index in place, so it must be aligned
+  bool ok = Pad();
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.fMagic, kMagic, sizeof(kMagic));
+  header.fVersion = kVersion;
+  header.fEntrySize = sizeof(TWaveformArchive::Entry);
+  header.fNEntries = fIndex.size();
+  header.fIndexOffset = fPosition;
+
+  if (ok && fIndex.size() > 0) {
+    ok = (fwrite(&fIndex[0], sizeof(TWaveformArchive::Entry), fIndex.size(), fFile)
+          == fIndex.size());
+  }
+  ok = ok && fseek(fFile, 0, SEEK_SET) == 0 &&
+       fwrite(&header, sizeof(header), 1, fFile) == 1;
+  ok = (fclose(fFile) == 0) && ok;
+  fFile = NULL;
+  fIndex.clear();
+  if (!ok) std::cerr << "Error writing archive" << std::endl;
+  return ok;
+}
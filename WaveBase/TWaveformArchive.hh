@@ -0,0 +1,126 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformArchive.hh
+ *
+ * DESCRIPTION:
+ *
+ * Flat binary waveform archive with a random access index.  The reader
+ * memory maps the file and hands out non-owning views of the samples.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformArchive_hh
+#define WAVE_TWaveformArchive_hh
+
+#ifndef WAVE_TTemplWaveformView_hh
+#include "TTemplWaveformView.hh"
+#endif
+#include <cstdio>
+#include <vector>
+
+class TWaveformArchive
+{
+  public:
+    enum EType { kUnknown = 0, kDouble = 1, kFloat = 2, kInt = 3,
+                 kUShort = 4, kShort = 5, kUInt = 6, kChar = 7, kComplex = 8 };
+
+    // One record of the index, as stored on disk.
+    struct Entry {
+      ULong64_t fOffset;     // Byte offset of the samples in the file
+      ULong64_t fLength;     // Number of samples
+      Double_t  fSampleFreq; // Sampling frequency
+      Double_t  fTOffset;    // Time offset
+      Int_t     fType;       // EType of the samples
+      Int_t     fReserved;
+    };
+
+    TWaveformArchive() : fMapping(NULL), fMappedSize(0), fIndex(NULL),
+                         fNEntries(0) {}
+    virtual ~TWaveformArchive() { Close(); }
+
+    bool Open(const char* fileName);
+    void Close();
+    bool IsOpen() const { return fMapping != NULL; }
+
+    size_t GetEntries() const { return fNEntries; }
+    const Entry& GetEntryInfo(size_t i) const { return fIndex[i]; }
+
+    // Views point directly into the mapping and are valid until Close().
+    // Returns false if i is out of range or the stored type does not match.
+    bool GetView(size_t i, TDoubleWaveformView& view) const { return FillView(i, kDouble, view); }
+    bool GetView(size_t i, TFloatWaveformView& view) const { return FillView(i, kFloat, view); }
+    bool GetView(size_t i, TIntWaveformView& view) const { return FillView(i, kInt, view); }
+    bool GetView(size_t i, TUShortWaveformView& view) const { return FillView(i, kUShort, view); }
+    bool GetView(size_t i, TShortWaveformView& view) const { return FillView(i, kShort, view); }
+    bool GetView(size_t i, TWaveformFTView& view) const { return FillView(i, kComplex, view); }
+
+    // Ask the kernel to read the whole archive ahead.
+    void WillNeed() const;
+
+  protected:
+    template<typename _Tp>
+    bool FillView(size_t i, Int_t type, TTemplWaveformView<_Tp>& view) const
+    {
+      if (i >= fNEntries || fIndex[i].fType != type) return false;
+      const Entry& e = fIndex[i];
+      view.Set(reinterpret_cast<const _Tp*>(static_cast<const char*>(fMapping) + e.fOffset),
+               static_cast<size_t>(e.fLength), e.fSampleFreq, e.fTOffset);
+      return true;
+    }
+
+    bool CheckEntries(const char* fileName) const;
+
+    void*        fMapping;    // Start of the mapped file
+    size_t       fMappedSize; // Size of the mapping
+    const Entry* fIndex;      // Index, inside the mapping
+    size_t       fNEntries;   // Number of entries
+
+  private:
+    TWaveformArchive(const TWaveformArchive&);
+    TWaveformArchive& operator=(const TWaveformArchive&);
+};
+
+class TWaveformArchiveWriter
+{
+  public:
+    TWaveformArchiveWriter() : fFile(NULL), fPosition(0) {}
+    virtual ~TWaveformArchiveWriter() { Close(); }
+
+    bool Open(const char* fileName);
+    // Writes the index and the header, the archive is not readable before.
+    bool Close();
+
+    bool Add(const TDoubleWaveform& wf) { return Add(wf, TWaveformArchive::kDouble); }
+    bool Add(const TFloatWaveform& wf)  { return Add(wf, TWaveformArchive::kFloat); }
+    bool Add(const TIntWaveform& wf)    { return Add(wf, TWaveformArchive::kInt); }
+    bool Add(const TUShortWaveform& wf) { return Add(wf, TWaveformArchive::kUShort); }
+    bool Add(const TShortWaveform& wf)  { return Add(wf, TWaveformArchive::kShort); }
+    bool Add(const TWaveformFT& wf)     { return Add(wf, TWaveformArchive::kComplex); }
+
+  protected:
+    template<typename _Tp>
+    bool Add(const TTemplWaveform<_Tp>& wf, Int_t type)
+    {
+      return AddBlock(wf.GetData(), wf.GetLength(), sizeof(_Tp), type,
+                      wf.GetSamplingFreq(), wf.GetTOffset());
+    }
+    bool AddBlock(const void* data, size_t length, size_t sampleSize, Int_t type,
+                  double freq, double toffset);
+    bool Pad();
+
+    FILE*                                 fFile;
+    ULong64_t                             fPosition;
+    std::vector<TWaveformArchive::Entry>  fIndex;
+
+  private:
+    TWaveformArchiveWriter(const TWaveformArchiveWriter&);
+    TWaveformArchiveWriter& operator=(const TWaveformArchiveWriter&);
+};
+
+#endif /* WAVE_TWaveformArchive_hh */
@@ -0,0 +1,119 @@
+#include "TWaveformBatch.hh"
+#include "TVWaveformTransformer.hh"
+#include "TFitWaveforms.hh"
+#include "TFastFourierTransformFFTW.hh"
+#include <cstring>
+//______________________________________________________________________________
+//
+//  TWaveformBatch
+//
+//  Runs the FFT, the transformers and the template fit over a whole batch of
+//  waveforms in a single call.  This is meant for scripts: looping over
+//  thousands of short waveforms in python is dominated by interpreter
+//  overhead, while here the loop runs in C++.  The batch is a C-contiguous
+//  2-D array of nChannels rows with nSamples each, passed by address:
+//
+//    import TWaveformBatch
+//    spectra = TWaveformBatch.fft(arr, freq)   # arr.shape = (nch, nsamp)
+//
+//  See python/TWaveformBatch.py.  Every row goes through a single scratch
+//  waveform, so the batch costs one copy in and one copy out per row and no
+//  allocations after the first row.  The calls use the shared FFT cache of
+//  TFastFourierTransformFFTW::GetFFT and must be made from one thread.
+//______________________________________________________________________________
+
+namespace {
+  typedef std::complex<double> CDbl;
+
+  void LoadRow(TDoubleWaveform& wf, const double* row, size_t nSamples, double freq)
+  {
+    wf.SetLength(nSamples);
+    if (nSamples > 0) std::memcpy(wf.GetData(), row, nSamples*sizeof(double));
+    wf.SetSamplingFreq(freq);
+    wf.SetTOffset(0.0);
+  }
+}
+
+//______________________________________________________________________________
+size_t TWaveformBatch::Transform(const TVWaveformTransformer& transformer,
+                                 ULong_t data, size_t nChannels, size_t nSamples,
+                                 double freq)
+{
+  double* rows = reinterpret_cast<double*>(data);
+  TDoubleWaveform wf;
+  for (size_t i=0;i<nChannels;i++) {
+    double* row = rows + i*nSamples;
+    LoadRow(wf, row, nSamples, freq);
+    transformer.Transform(&wf);
+    if (wf.GetLength() != nSamples) {
+      std::string message = transformer.GetStringName() + " changed the waveform length";
+      TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength, message.c_str());
+      return i;
+    }
+    if (nSamples > 0) std::memcpy(row, wf.GetData(), nSamples*sizeof(double));
+  }
+  return nChannels;
+}
+
+//______________________________________________________________________________
+size_t TWaveformBatch::PerformFFT(ULong_t data, ULong_t spectra,
+                                  size_t nChannels, size_t nSamples, double freq)
+{
+  const double* rows = reinterpret_cast<const double*>(data);
+  CDbl* out = reinterpret_cast<CDbl*>(spectra);
+  const size_t nFreq = nSamples/2 + 1;
+  TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(nSamples);
+  TDoubleWaveform wf;
+  TWaveformFT wfFT;
+  for (size_t i=0;i<nChannels;i++) {
+    LoadRow(wf, rows + i*nSamples, nSamples, freq);
+    fft.PerformFFT(wf, wfFT);
+    if (wfFT.GetLength() != nFreq) return i;
+    std::memcpy(out + i*nFreq, wfFT.GetData(), nFreq*sizeof(CDbl));
+  }
+  return nChannels;
+}
+
+//______________________________________________________________________________
+size_t TWaveformBatch::PerformInverseFFT(ULong_t data, ULong_t spectra,
+                                         size_t nChannels, size_t nSamples, double freq,
+                                         bool normalize)
+{
+  double* rows = reinterpret_cast<double*>(data);
+  const CDbl* in = reinterpret_cast<const CDbl*>(spectra);
+  const size_t nFreq = nSamples/2 + 1;
+  TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(nSamples);
+  TDoubleWaveform wf;
+  TWaveformFT wfFT;
+  wfFT.SetLength(nFreq);
+  wfFT.SetSamplingFreq(freq);
+  for (size_t i=0;i<nChannels;i++) {
+    std::memcpy(wfFT.GetData(), in + i*nFreq, nFreq*sizeof(CDbl));
+    // wfFT is a copy, so FFTW may destroy it
+    fft.PerformInverseFFTDestroyInput(wf, wfFT, normalize);
+    if (wf.GetLength() != nSamples) return i;
+    std::memcpy(rows + i*nSamples, wf.GetData(), nSamples*sizeof(double));
+  }
+  return nChannels;
+}
+
+//______________________________________________________________________________
+size_t TWaveformBatch::FitOffsets(TFitWaveforms& fit,
+                                  ULong_t data, size_t nChannels, size_t nSamples,
+                                  ULong_t offsets, ULong_t errors, double freq)
+{
+  // The initial offset of every fit is the one set in fit before the call.
+  const double* rows = reinterpret_cast<const double*>(data);
+  double* offsetOut = reinterpret_cast<double*>(offsets);
+  double* errorOut = reinterpret_cast<double*>(errors);
+  const double initial = fit.GetOffset();
+  TDoubleWaveform wf;
+  for (size_t i=0;i<nChannels;i++) {
+    LoadRow(wf, rows + i*nSamples, nSamples, freq);
+    fit.SetInitialOffset(initial);
+    fit.Transform(&wf);
+    offsetOut[i] = fit.GetOffset();
+    if (errorOut) errorOut[i] = fit.GetOffsetError();
+  }
+  return nChannels;
+}
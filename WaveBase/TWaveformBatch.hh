@@ -0,0 +1,65 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformBatch.hh
+ *
+ * DESCRIPTION:
+ *
+ * Batch processing of many equal-length waveforms stored as the rows of a
+ * contiguous 2-D array (channels x samples), e.g. a NumPy array.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformBatch_hh
+#define WAVE_TWaveformBatch_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+
+class TVWaveformTransformer;
+class TFitWaveforms;
+
+class TWaveformBatch
+{
+  public:
+    // All addresses point to row-major, C-contiguous arrays of doubles (or
+    // of complex<double> for spectra).  freq is the sampling frequency of
+    // the rows (CLHEP units).  The number of rows processed is returned; it
+    // is less than nChannels if a row failed, the rows from there on are
+    // left as they were.
+
+    // Apply transformer to every row, in place.
+    static size_t Transform(const TVWaveformTransformer& transformer,
+                            ULong_t data, size_t nChannels, size_t nSamples,
+                            double freq = CLHEP::megahertz);
+
+    // Forward FFT of every row.  spectra must hold nChannels x
+    // (nSamples/2 + 1) complex values.
+    static size_t PerformFFT(ULong_t data, ULong_t spectra,
+                             size_t nChannels, size_t nSamples,
+                             double freq = CLHEP::megahertz);
+
+    // Inverse FFT of every row of spectra (nChannels x (nSamples/2 + 1))
+    // into data (nChannels x nSamples).  Unnormalised, as PerformInverseFFT,
+    // unless normalize is set.
+    static size_t PerformInverseFFT(ULong_t data, ULong_t spectra,
+                                    size_t nChannels, size_t nSamples,
+                                    double freq = CLHEP::megahertz,
+                                    bool normalize = false);
+
+    // Fit the template of fit to every row, storing the best time offset and
+    // its error in offsets and errors (nChannels doubles each, errors may be
+    // 0).
+    static size_t FitOffsets(TFitWaveforms& fit,
+                             ULong_t data, size_t nChannels, size_t nSamples,
+                             ULong_t offsets, ULong_t errors = 0,
+                             double freq = CLHEP::megahertz);
+};
+
+#endif /* WAVE_TWaveformBatch_hh */
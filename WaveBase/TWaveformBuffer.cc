@@ -0,0 +1,250 @@
+#include "TWaveformBuffer.hh"
+#include "TClass.h"
+#include <cstring>
+//______________________________________________________________________________
+//
+//  TWaveformBuffer
+//
+//  Type-erased access to the sample buffer of the TTemplWaveform
+//  instantiations in LinkDef.h.in.  Scripts (CINT, PyROOT) cannot easily
+//  resolve templates, so all functions take a TObject and find the sample
+//  type with IsA(), in the same way as TTemplWaveform::ConvertFrom().
+//
+//  This is the C++ side of the NumPy bridge in python/TWaveformNumpy.py,
+//  which builds the __array_interface__ of a waveform from GetAddress(),
+//  GetLength() and GetTypeString() so that numpy.asarray(wf) is a view of
+//  the waveform data without a copy.
+//______________________________________________________________________________
+
+namespace {
+  template<typename _Tp> struct TypeCode { static char Kind() { return 'i'; } };
+  template<> struct TypeCode<UShort_t>      { static char Kind() { return 'u'; } };
+  template<> struct TypeCode<unsigned int>  { static char Kind() { return 'u'; } };
+  template<> struct TypeCode<unsigned long> { static char Kind() { return 'u'; } };
+  template<> struct TypeCode<Double_t>      { static char Kind() { return 'f'; } };
+  template<> struct TypeCode<Float_t>       { static char Kind() { return 'f'; } };
+  template<> struct TypeCode<std::complex<double> > { static char Kind() { return 'c'; } };
+
+  char ByteOrder()
+  {
+    const unsigned int one = 1;
+    return (*reinterpret_cast<const char*>(&one) == 1) ? '<' : '>';
+  }
+
+  template<typename _Tp>
+  const char* TypeString()
+  {
+    // e.g. "<f8", built once per type
+    static char str[8] = { 0 };
+    if (str[0] == 0) {
+      char kind = TypeCode<_Tp>::Kind();
+      size_t size = sizeof(_Tp);
+      str[1] = kind;
+      if (size >= 10) {
+        str[2] = '0' + size/10;
+        str[3] = '0' + size%10;
+      } else {
+        str[2] = '0' + size;
+      }
+      str[0] = (size == 1) ? '|' : ByteOrder();
+    }
+    return str;
+  }
+
+  struct BufferInfo {
+    ULong_t     fAddress;
+    size_t      fItemSize;
+    size_t      fLength;
+    const char* fType;
+    BufferInfo() : fAddress(0), fItemSize(0), fLength(0), fType("") {}
+    template<typename _Tp> void operator()(const TTemplWaveform<_Tp>& wf)
+    {
+      fAddress = reinterpret_cast<ULong_t>(wf.GetData());
+      fItemSize = sizeof(_Tp);
+      fLength = wf.GetLength();
+      fType = TypeString<_Tp>();
+    }
+  };
+
+  struct Resize {
+    size_t fLength;
+    template<typename _Tp> void operator()(TTemplWaveform<_Tp>& wf) { wf.SetLength(fLength); }
+  };
+
+  struct Copy {
+    const void* fSource;
+    size_t      fLength;
+    template<typename _Tp> void operator()(TTemplWaveform<_Tp>& wf)
+    {
+      wf.SetLength(fLength);
+      if (fLength > 0) std::memcpy(wf.GetData(), fSource, fLength*sizeof(_Tp));
+    }
+  };
+
+#define WAVEBUFFER_CASE(atype, aWF, aOp, aConst)                          \
+  if (aWF.IsA()->InheritsFrom(TTemplWaveform<atype >::Class())) {         \
+    aOp(static_cast<aConst TTemplWaveform<atype >&>(aWF));                \
+    return true; }
+
+#define WAVEBUFFER_ALL_CASES(aWF, aOp, aConst)                            \
+  WAVEBUFFER_CASE(Double_t, aWF, aOp, aConst)                             \
+  WAVEBUFFER_CASE(Float_t, aWF, aOp, aConst)                              \
+  WAVEBUFFER_CASE(Int_t, aWF, aOp, aConst)                                \
+  WAVEBUFFER_CASE(UShort_t, aWF, aOp, aConst)                             \
+  WAVEBUFFER_CASE(Short_t, aWF, aOp, aConst)                              \
+  WAVEBUFFER_CASE(unsigned long, aWF, aOp, aConst)                        \
+  WAVEBUFFER_CASE(unsigned int, aWF, aOp, aConst)                         \
+  WAVEBUFFER_CASE(Char_t, aWF, aOp, aConst)                               \
+  WAVEBUFFER_CASE(std::complex<double>, aWF, aOp, aConst)
+
+  template<class _Op>
+  bool Dispatch(const TObject& wf, _Op& op)
+  {
+    WAVEBUFFER_ALL_CASES(wf, op, const)
+    return false;
+  }
+
+  template<class _Op>
+  bool DispatchMutable(TObject& wf, _Op& op)
+  {
+    WAVEBUFFER_ALL_CASES(wf, op, )
+    std::cerr << "Input waveform type not recognized!" << std::endl;
+    return false;
+  }
+
+  template<typename _Tp>
+  void FillView(ULong_t address, size_t length, double freq, double toffset,
+                TTemplWaveformView<_Tp>& view)
+  {
+    view.Set(reinterpret_cast<const _Tp*>(address), length, freq, toffset);
+  }
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TObject& wf)
+{
+  BufferInfo info;
+  Dispatch(wf, info);
+  return info.fAddress;
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TDoubleWaveformView& view)
+{
+  return reinterpret_cast<ULong_t>(view.GetData());
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TFloatWaveformView& view)
+{
+  return reinterpret_cast<ULong_t>(view.GetData());
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TIntWaveformView& view)
+{
+  return reinterpret_cast<ULong_t>(view.GetData());
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TUShortWaveformView& view)
+{
+  return reinterpret_cast<ULong_t>(view.GetData());
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TShortWaveformView& view)
+{
+  return reinterpret_cast<ULong_t>(view.GetData());
+}
+
+//______________________________________________________________________________
+ULong_t TWaveformBuffer::GetAddress(const TWaveformFTView& view)
+{
+  return reinterpret_cast<ULong_t>(view.GetData());
+}
+
+//______________________________________________________________________________
+size_t TWaveformBuffer::GetItemSize(const TObject& wf)
+{
+  BufferInfo info;
+  Dispatch(wf, info);
+  return info.fItemSize;
+}
+
+//______________________________________________________________________________
+size_t TWaveformBuffer::GetLength(const TObject& wf)
+{
+  BufferInfo info;
+  Dispatch(wf, info);
+  return info.fLength;
+}
+
+//______________________________________________________________________________
+const char* TWaveformBuffer::GetTypeString(const TObject& wf)
+{
+  BufferInfo info;
+  Dispatch(wf, info);
+  return info.fType;
+}
+
+//______________________________________________________________________________
+bool TWaveformBuffer::SetLength(TObject& wf, size_t length)
+{
+  Resize op;
+  op.fLength = length;
+  return DispatchMutable(wf, op);
+}
+
+//______________________________________________________________________________
+bool TWaveformBuffer::CopyFrom(TObject& wf, ULong_t address, size_t length)
+{
+  // The caller guarantees that address holds length samples of the type of
+  // wf (python/TWaveformNumpy.py checks the dtype).
+  Copy op;
+  op.fSource = reinterpret_cast<const void*>(address);
+  op.fLength = length;
+  return DispatchMutable(wf, op);
+}
+
+//______________________________________________________________________________
+void TWaveformBuffer::MakeView(ULong_t address, size_t length, double freq, double toffset,
+                               TDoubleWaveformView& view)
+{
+  FillView(address, length, freq, toffset, view);
+}
+
+//______________________________________________________________________________
+void TWaveformBuffer::MakeView(ULong_t address, size_t length, double freq, double toffset,
+                               TFloatWaveformView& view)
+{
+  FillView(address, length, freq, toffset, view);
+}
+
+//______________________________________________________________________________
+void TWaveformBuffer::MakeView(ULong_t address, size_t length, double freq, double toffset,
+                               TIntWaveformView& view)
+{
+  FillView(address, length, freq, toffset, view);
+}
+
+//______________________________________________________________________________
+void TWaveformBuffer::MakeView(ULong_t address, size_t length, double freq, double toffset,
+                               TUShortWaveformView& view)
+{
+  FillView(address, length, freq, toffset, view);
+}
+
+//______________________________________________________________________________
+void TWaveformBuffer::MakeView(ULong_t address, size_t length, double freq, double toffset,
+                               TShortWaveformView& view)
+{
+  FillView(address, length, freq, toffset, view);
+}
+
+//______________________________________________________________________________
+void TWaveformBuffer::MakeView(ULong_t address, size_t length, double freq, double toffset,
+                               TWaveformFTView& view)
+{
+  FillView(address, length, freq, toffset, view);
+}
@@ -0,0 +1,68 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformBuffer.hh
+ *
+ * DESCRIPTION:
+ *
+ * Raw access to the sample buffer of any TTemplWaveform through a TObject
+ * reference, for scripting languages (see python/TWaveformNumpy.py).
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformBuffer_hh
+#define WAVE_TWaveformBuffer_hh
+
+#ifndef WAVE_TTemplWaveformView_hh
+#include "TTemplWaveformView.hh"
+#endif
+
+class TWaveformBuffer
+{
+  public:
+    // Address of the first sample, 0 if the waveform is empty or the type
+    // is not recognized.
+    static ULong_t GetAddress(const TObject& wf);
+    static ULong_t GetAddress(const TDoubleWaveformView& view);
+    static ULong_t GetAddress(const TFloatWaveformView& view);
+    static ULong_t GetAddress(const TIntWaveformView& view);
+    static ULong_t GetAddress(const TUShortWaveformView& view);
+    static ULong_t GetAddress(const TShortWaveformView& view);
+    static ULong_t GetAddress(const TWaveformFTView& view);
+    // Size in bytes of one sample, 0 if the type is not recognized.
+    static size_t GetItemSize(const TObject& wf);
+    // Number of samples.
+    static size_t GetLength(const TObject& wf);
+    // NumPy array-interface type string of the samples, e.g. "<f8", "<i2",
+    // "<c16".  Empty if the type is not recognized.
+    static const char* GetTypeString(const TObject& wf);
+
+    // Resize wf (contents undefined) so that it can be filled through its
+    // address.
+    static bool SetLength(TObject& wf, size_t length);
+    // Copy length samples of the same type as wf from address, with a
+    // single memcpy.
+    static bool CopyFrom(TObject& wf, ULong_t address, size_t length);
+
+    // Point a view at length samples at address, no copy.  The memory must
+    // outlive the view.
+    static void MakeView(ULong_t address, size_t length, double freq, double toffset,
+                         TDoubleWaveformView& view);
+    static void MakeView(ULong_t address, size_t length, double freq, double toffset,
+                         TFloatWaveformView& view);
+    static void MakeView(ULong_t address, size_t length, double freq, double toffset,
+                         TIntWaveformView& view);
+    static void MakeView(ULong_t address, size_t length, double freq, double toffset,
+                         TUShortWaveformView& view);
+    static void MakeView(ULong_t address, size_t length, double freq, double toffset,
+                         TShortWaveformView& view);
+    static void MakeView(ULong_t address, size_t length, double freq, double toffset,
+                         TWaveformFTView& view);
+};
+
+#endif /* WAVE_TWaveformBuffer_hh */
@@ -0,0 +1,321 @@
+#include "TWaveformCodec.hh"
+#include <cstring>
+//______________________________________________________________________________
+// TWaveformCodec
+//
+// Lossless compression of integer ADC waveforms (TShortWaveform,
+// TUShortWaveform, TIntWaveform).  Raw traces are mostly a slowly varying
+// baseline, so the sample-to-sample differences need only a few bits.  The
+// codec does:
+//
+//   1. prediction: residual r[i] = x[i] - p[i] with p[i] = x[i-1] (kDelta)
+//      or p[i] = 2*x[i-1] - x[i-2] (kLinear).  Arithmetic is modulo 2^32 so
+//      that the codec is lossless for the full Int_t range.
+//   2. zigzag encoding: signed residuals are mapped to unsigned values,
+//      0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+//   3. bit-packing: residuals are grouped in blocks of kBlockSize (128)
+//      values, each block is stored with the minimum bit width b that holds
+//      its largest value.
+//
+// Full blocks are packed in a 4-lane vertical layout: value j goes to lane
+// j%4, and the output word k of lane l is stored at position 4*k + l.  All
+// four lanes always shift by the same amount, so the packing and unpacking
+// loops are plain 4-wide operations that the compiler vectorizes without
+// intrinsics.  The (possibly partial) last block is packed sequentially.
+//
+// Format (all multi-byte values little-endian):
+//
+//   'W' 'C' version predictor   4 bytes
+//   number of samples           4 bytes
+//   per full block:             1 byte bit width, 16*b bytes
+//   partial last block:         1 byte bit width, (m*b + 7)/8 bytes
+//
+// Usage:
+//
+//   std::vector<UChar_t> buf;
+//   TWaveformCodec::Encode(shortWF, buf);
+//   ...
+//   TWaveformCodec::Decode(&buf[0], buf.size(), shortWF);
+//
+// To store encoded waveforms in ROOT files, see TEncodedWaveform.
+//______________________________________________________________________________
+
+const size_t TWaveformCodec::kBlockSize;
+
+namespace {
+  const UChar_t kVersion = 1;
+  const size_t  kHeaderSize = 8;
+  const size_t  kLanes = 4;
+
+  inline void StoreLE32(UChar_t* p, UInt_t v)
+  {
+    p[0] = static_cast<UChar_t>(v);
+    p[1] = static_cast<UChar_t>(v >> 8);
+    p[2] = static_cast<UChar_t>(v >> 16);
+    p[3] = static_cast<UChar_t>(v >> 24);
+  }
+
+  inline UInt_t LoadLE32(const UChar_t* p)
+  {
+    return static_cast<UInt_t>(p[0]) | (static_cast<UInt_t>(p[1]) << 8) |
+           (static_cast<UInt_t>(p[2]) << 16) | (static_cast<UInt_t>(p[3]) << 24);
+  }
+
+  inline UInt_t ZigZag(UInt_t r)
+  {
+    return (r << 1) ^ static_cast<UInt_t>(static_cast<Int_t>(r) >> 31);
+  }
+
+  inline UInt_t UnZigZag(UInt_t z)
+  {
+    return (z >> 1) ^ (0U - (z & 1));
+  }
+
+  inline UInt_t BitWidth(const UInt_t* in, size_t n)
+  {
+    UInt_t acc = 0;
+    for (size_t i=0;i<n;i++) acc |= in[i];
+    UInt_t b = 0;
+    while (acc) { b++; acc >>= 1; }
+    return b;
+  }
+
+  // Reinterpret samples as 32-bit unsigned values for modular arithmetic.
+  inline UInt_t ToU32(Short_t v)  { return static_cast<UInt_t>(static_cast<Int_t>(v)); }
+  inline UInt_t ToU32(UShort_t v) { return static_cast<UInt_t>(v); }
+  inline UInt_t ToU32(Int_t v)    { return static_cast<UInt_t>(v); }
+
+  //____________________________________________________________________________
+  size_t PackBlock(const UInt_t* in, UInt_t b, UChar_t* out)
+  {
+    // Pack kBlockSize values of b bits in the 4-lane vertical layout.
+    // Returns the number of bytes written (16*b).
+    if (b == 0) return 0;
+    const size_t perLane = TWaveformCodec::kBlockSize/kLanes;
+    if (b == 32) {
+      for (size_t j=0;j<perLane;j++) {
+        for (size_t l=0;l<kLanes;l++) StoreLE32(out + 4*(kLanes*j + l), in[kLanes*j + l]);
+      }
+      return 4*TWaveformCodec::kBlockSize;
+    }
+    UInt_t acc[kLanes] = {0, 0, 0, 0};
+    UInt_t shift = 0;
+    UChar_t* o = out;
+    for (size_t j=0;j<perLane;j++) {
+      const UInt_t* v = in + kLanes*j;
+      for (size_t l=0;l<kLanes;l++) acc[l] |= v[l] << shift;
+      shift += b;
+      if (shift >= 32) {
+        for (size_t l=0;l<kLanes;l++) StoreLE32(o + 4*l, acc[l]);
+        o += 4*kLanes;
+        shift -= 32;
+        if (shift > 0) {
+          for (size_t l=0;l<kLanes;l++) acc[l] = v[l] >> (b - shift);
+        } else {
+          for (size_t l=0;l<kLanes;l++) acc[l] = 0;
+        }
+      }
+    }
+    // 32 values of b bits per lane fill exactly b words, nothing is left in acc.
+    return o - out;
+  }
+
+  //____________________________________________________________________________
+  void UnpackBlock(const UChar_t* in, UInt_t b, UInt_t* out)
+  {
+    // Inverse of PackBlock.
+    const size_t perLane = TWaveformCodec::kBlockSize/kLanes;
+    if (b == 0) {
+      for (size_t i=0;i<TWaveformCodec::kBlockSize;i++) out[i] = 0;
+      return;
+    }
+    if (b == 32) {
+      for (size_t i=0;i<TWaveformCodec::kBlockSize;i++) out[i] = LoadLE32(in + 4*i);
+      return;
+    }
+    const UInt_t mask = (1U << b) - 1;
+    UInt_t cur[kLanes];
+    for (size_t l=0;l<kLanes;l++) cur[l] = LoadLE32(in + 4*l);
+    const UChar_t* p = in + 4*kLanes;
+    UInt_t shift = 0;
+    for (size_t j=0;j<perLane;j++) {
+      UInt_t* v = out + kLanes*j;
+      if (shift + b <= 32) {
+        for (size_t l=0;l<kLanes;l++) v[l] = (cur[l] >> shift) & mask;
+        shift += b;
+        if (shift == 32 && j+1 < perLane) {
+          for (size_t l=0;l<kLanes;l++) cur[l] = LoadLE32(p + 4*l);
+          p += 4*kLanes;
+          shift = 0;
+        }
+      } else {
+        const UInt_t low = 32 - shift;
+        for (size_t l=0;l<kLanes;l++) {
+          UInt_t next = LoadLE32(p + 4*l);
+          v[l] = ((cur[l] >> shift) | (next << low)) & mask;
+          cur[l] = next;
+        }
+        p += 4*kLanes;
+        shift = b - low;
+      }
+    }
+  }
+
+  //____________________________________________________________________________
+  size_t PackTail(const UInt_t* in, size_t n, UInt_t b, UChar_t* out)
+  {
+    // Sequential LSB-first packing of n < kBlockSize values.
+    size_t bytes = (n*b + 7)/8;
+    std::memset(out, 0, bytes);
+    size_t bit = 0;
+    for (size_t i=0;i<n;i++) {
+      for (UInt_t k=0;k<b;k++,bit++) {
+        if ((in[i] >> k) & 1) out[bit/8] |= static_cast<UChar_t>(1U << (bit%8));
+      }
+    }
+    return bytes;
+  }
+
+  //____________________________________________________________________________
+  void UnpackTail(const UChar_t* in, size_t n, UInt_t b, UInt_t* out)
+  {
+    size_t bit = 0;
+    for (size_t i=0;i<n;i++) {
+      UInt_t v = 0;
+      for (UInt_t k=0;k<b;k++,bit++) v |= static_cast<UInt_t>((in[bit/8] >> (bit%8)) & 1) << k;
+      out[i] = v;
+    }
+  }
+
+  //____________________________________________________________________________
+  template<typename _Tp>
+  size_t EncodeImpl(const _Tp* data, size_t n, std::vector<UChar_t>& out,
+                    TWaveformCodec::EPredictor pred)
+  {
+    const size_t bs = TWaveformCodec::kBlockSize;
+    // Worst case: every block at 32 bits.
+    out.resize(kHeaderSize + (n/bs + 1)*(1 + 4*bs));
+    UChar_t* o = &out[0];
+    o[0] = 'W'; o[1] = 'C'; o[2] = kVersion; o[3] = static_cast<UChar_t>(pred);
+    StoreLE32(o + 4, static_cast<UInt_t>(n));
+    o += kHeaderSize;
+
+    UInt_t res[TWaveformCodec::kBlockSize];
+    UInt_t prev1 = 0, prev2 = 0;
+    for (size_t start=0;start<n;start+=bs) {
+      size_t m = (n - start < bs) ? n - start : bs;
+      for (size_t i=0;i<m;i++) {
+        UInt_t x = ToU32(data[start + i]);
+        size_t idx = start + i;
+        UInt_t p = (pred == TWaveformCodec::kLinear && idx >= 2) ? 2*prev1 - prev2 : prev1;
+        res[i] = ZigZag(x - p);
+        prev2 = prev1;
+        prev1 = x;
+      }
+      UInt_t b = BitWidth(res, m);
+      *o++ = static_cast<UChar_t>(b);
+      o += (m == bs) ? PackBlock(res, b, o) : PackTail(res, m, b, o);
+    }
+    out.resize(o - &out[0]);
+    return out.size();
+  }
+
+  //____________________________________________________________________________
+  template<typename _Tp>
+  bool DecodeImpl(const UChar_t* buffer, size_t bytes, TTemplWaveform<_Tp>& wf)
+  {
+    const size_t bs = TWaveformCodec::kBlockSize;
+    wf.SetLength(0);
+    // The header check bounds n by the buffer size before allocating
+    if (!TWaveformCodec::IsValidHeader(buffer, bytes)) return false;
+    size_t n = LoadLE32(buffer + 4);
+    wf.SetLength(n);
+    UChar_t pred = buffer[3];
+    const UChar_t* p = buffer + kHeaderSize;
+    const UChar_t* end = buffer + bytes;
+    _Tp* data = wf.GetData();
+
+    UInt_t res[TWaveformCodec::kBlockSize];
+    UInt_t prev1 = 0, prev2 = 0;
+    for (size_t start=0;start<n;start+=bs) {
+      size_t m = (n - start < bs) ? n - start : bs;
+      if (p >= end) { wf.SetLength(0); return false; }
+      UInt_t b = *p++;
+      size_t packed = (m == bs) ? 4*b*bs/32 : (m*b + 7)/8;
+      if (b > 32 || p + packed > end) { wf.SetLength(0); return false; }
+      if (m == bs) UnpackBlock(p, b, res);
+      else UnpackTail(p, m, b, res);
+      p += packed;
+      for (size_t i=0;i<m;i++) {
+        size_t idx = start + i;
+        UInt_t pv = (pred == TWaveformCodec::kLinear && idx >= 2) ? 2*prev1 - prev2 : prev1;
+        UInt_t x = UnZigZag(res[i]) + pv;
+        data[idx] = static_cast<_Tp>(static_cast<Int_t>(x));
+        prev2 = prev1;
+        prev1 = x;
+      }
+    }
+    return true;
+  }
+}
+
+//______________________________________________________________________________
+size_t TWaveformCodec::Encode(const TShortWaveform& wf, std::vector<UChar_t>& out,
+                              EPredictor pred)
+{
+  return EncodeImpl(wf.GetData(), wf.GetLength(), out, pred);
+}
+
+//______________________________________________________________________________
+size_t TWaveformCodec::Encode(const TUShortWaveform& wf, std::vector<UChar_t>& out,
+                              EPredictor pred)
+{
+  return EncodeImpl(wf.GetData(), wf.GetLength(), out, pred);
+}
+
+//______________________________________________________________________________
+size_t TWaveformCodec::Encode(const TIntWaveform& wf, std::vector<UChar_t>& out,
+                              EPredictor pred)
+{
+  return EncodeImpl(wf.GetData(), wf.GetLength(), out, pred);
+}
+
+//______________________________________________________________________________
+bool TWaveformCodec::Decode(const UChar_t* buffer, size_t bytes, TShortWaveform& wf)
+{
+  return DecodeImpl(buffer, bytes, wf);
+}
+
+//______________________________________________________________________________
+bool TWaveformCodec::Decode(const UChar_t* buffer, size_t bytes, TUShortWaveform& wf)
+{
+  return DecodeImpl(buffer, bytes, wf);
+}
+
+//______________________________________________________________________________
+bool TWaveformCodec::Decode(const UChar_t* buffer, size_t bytes, TIntWaveform& wf)
+{
+  return DecodeImpl(buffer, bytes, wf);
+}
+
+//______________________________________________________________________________
+size_t TWaveformCodec::GetEncodedLength(const UChar_t* buffer, size_t bytes)
+{
+  // Returns the number of samples in the encoded buffer, or 0 if the header
+  // is not recognized.
+  return IsValidHeader(buffer, bytes) ? LoadLE32(buffer + 4) : 0;
+}
+
+//______________________________________________________________________________
+bool TWaveformCodec::IsValidHeader(const UChar_t* buffer, size_t bytes)
+{
+  // Returns true if buffer begins with a header written by this codec, and
+  // the number of samples it claims can be stored in bytes (every block of
+  // up to kBlockSize values takes at least its bit-width byte), so that a
+  // corrupt header cannot make the decoder allocate an arbitrary length.
+  if (buffer == NULL || bytes < kHeaderSize) return false;
+  if (buffer[0] != 'W' || buffer[1] != 'C' || buffer[2] != kVersion) return false;
+  if (buffer[3] != kDelta && buffer[3] != kLinear) return false;
+  const size_t blocks = (LoadLE32(buffer + 4) + kBlockSize - 1)/kBlockSize;
+  return blocks <= bytes - kHeaderSize;
+}
@@ -0,0 +1,59 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformCodec.hh
+ *
+ * DESCRIPTION:
+ *
+ * Lossless codec for integer ADC waveforms: prediction residuals, zigzag
+ * encoding and block-wise bit-packing.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformCodec_hh
+#define WAVE_TWaveformCodec_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+#include <vector>
+
+class TWaveformCodec
+{
+  public:
+    enum EPredictor {
+      kDelta  = 1, // residual = x[i] - x[i-1]
+      kLinear = 2  // residual = x[i] - (2*x[i-1] - x[i-2])
+    };
+
+    // Number of samples packed with a common bit width.
+    static const size_t kBlockSize = 128;
+
+    // Encode the samples of a waveform, replacing the contents of out.
+    // Returns the number of bytes written.  Only the samples are encoded,
+    // sampling frequency and time offset are left to the caller (see
+    // TEncodedWaveform).
+    static size_t Encode(const TShortWaveform& wf, std::vector<UChar_t>& out,
+                         EPredictor pred = kDelta);
+    static size_t Encode(const TUShortWaveform& wf, std::vector<UChar_t>& out,
+                         EPredictor pred = kDelta);
+    static size_t Encode(const TIntWaveform& wf, std::vector<UChar_t>& out,
+                         EPredictor pred = kDelta);
+
+    // Decode a buffer produced by Encode into wf.  Returns false if the
+    // buffer is malformed, in which case wf is left empty.
+    static bool Decode(const UChar_t* buffer, size_t bytes, TShortWaveform& wf);
+    static bool Decode(const UChar_t* buffer, size_t bytes, TUShortWaveform& wf);
+    static bool Decode(const UChar_t* buffer, size_t bytes, TIntWaveform& wf);
+
+    // Number of samples stored in an encoded buffer, 0 if malformed.
+    static size_t GetEncodedLength(const UChar_t* buffer, size_t bytes);
+    static bool IsValidHeader(const UChar_t* buffer, size_t bytes);
+};
+
+#endif /* WAVE_TWaveformCodec_hh */
@@ -0,0 +1,179 @@
+#include "TWaveformDiagnostics.hh"
+#include <cstdio>
+#include <iostream>
+#include <pthread.h>
+#include <time.h>
+//______________________________________________________________________________
+//
+//  TWaveformDiagnostics
+//
+//  Errors of operations that can run millions of times (waveform
+//  arithmetic, GetIndexAtTime, FFT length checks, ...) are reported here
+//  instead of being written to std::cout/std::cerr directly, so that a
+//  malformed channel cannot flood the logs or serialize all threads on the
+//  stream lock.
+//
+//  Every error is counted per code (GetCount).  At most GetRateLimit()
+//  reports per second and code are passed to the sink; the number of
+//  suppressed reports is given with the next one that passes.  Once a code
+//  is over its limit, further reports in the same second only read the
+//  clock and do two atomic additions, so a flood of errors does not
+//  serialize the threads on the lock.  The default
+//  sink writes to std::cerr, another one is installed with SetSink, e.g. to
+//  forward to a logging framework:
+//
+//    class MySink : public TWaveformDiagnostics::Sink {
+//      void Report(TWaveformDiagnostics::ECode code, const char* message) { ... }
+//    };
+//    static MySink sink;
+//    TWaveformDiagnostics::SetSink(&sink);
+//
+//  SetSilent(true) drops all reports, leaving only the counts.  The checks
+//  themselves are unchanged, and nothing is done on the success path.
+//______________________________________________________________________________
+
+bool TWaveformDiagnostics::fSilent = false;
+size_t TWaveformDiagnostics::fRateLimit = 10;
+
+namespace {
+  class StreamSink : public TWaveformDiagnostics::Sink
+  {
+    public:
+      virtual void Report(TWaveformDiagnostics::ECode, const char* message)
+        { std::cerr << message << std::endl; }
+  };
+
+  StreamSink gDefaultSink;
+  TWaveformDiagnostics::Sink* gSink = &gDefaultSink;
+
+  // Rate limiting per code, under gMutex.  gSuppressedUntil is also read
+  // and gSuppressed incremented without the lock.
+  pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+  time_t    gWindow[TWaveformDiagnostics::kNumCodes];
+  size_t    gReported[TWaveformDiagnostics::kNumCodes];
+  volatile time_t gSuppressedUntil[TWaveformDiagnostics::kNumCodes];
+  ULong64_t gSuppressed[TWaveformDiagnostics::kNumCodes];
+
+  ULong64_t gCounts[TWaveformDiagnostics::kNumCodes];
+
+  inline void AtomicIncrement(ULong64_t& counter)
+  {
+#ifdef __GNUC__
+    __sync_fetch_and_add(&counter, 1);
+#else
+    counter++;
+#endif
+  }
+
+  // Returns the value and sets it to 0
+  inline ULong64_t AtomicTake(ULong64_t& counter)
+  {
+#ifdef __GNUC__
+    return __sync_fetch_and_and(&counter, 0);
+#else
+    ULong64_t old = counter;
+    counter = 0;
+    return old;
+#endif
+  }
+
+  class Lock
+  {
+    public:
+      Lock() { pthread_mutex_lock(&gMutex); }
+      ~Lock() { pthread_mutex_unlock(&gMutex); }
+  };
+}
+
+//______________________________________________________________________________
+void TWaveformDiagnostics::Report(ECode code, const char* message)
+{
+  // Count the error and pass it to the sink, unless silenced or over the
+  // rate limit.
+  if (code <= kNoError || code >= kNumCodes) return;
+  AtomicIncrement(gCounts[code]);
+  if (fSilent) return;
+
+  // Over the limit in this second: count without taking the lock
+  time_t now = 0;
+  if (fRateLimit > 0) {
+    now = time(NULL);
+    if (now < gSuppressedUntil[code]) {
+      AtomicIncrement(gSuppressed[code]);
+      return;
+    }
+  }
+
+  Lock lock;
+  ULong64_t suppressed = 0;
+  if (fRateLimit > 0) {
+    if (now != gWindow[code]) {
+      gWindow[code] = now;
+      gReported[code] = 0;
+    }
+    if (gReported[code] >= fRateLimit) {
+      AtomicIncrement(gSuppressed[code]);
+      return;
+    }
+    if (++gReported[code] >= fRateLimit) gSuppressedUntil[code] = now + 1;
+    suppressed = AtomicTake(gSuppressed[code]);
+  }
+  if (suppressed > 0) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "(%llu more errors of type %s were suppressed)",
+             (unsigned long long)suppressed, GetCodeName(code));
+    gSink->Report(code, buf);
+  }
+  gSink->Report(code, message);
+}
+
+//______________________________________________________________________________
+void TWaveformDiagnostics::SetSink(Sink* sink)
+{
+  // Install sink (not owned), NULL restores the default std::cerr sink.
+  Lock lock;
+  gSink = (sink == NULL) ? &gDefaultSink : sink;
+}
+
+//______________________________________________________________________________
+TWaveformDiagnostics::Sink* TWaveformDiagnostics::GetSink()
+{
+  return gSink;
+}
+
+//______________________________________________________________________________
+ULong64_t TWaveformDiagnostics::GetCount(ECode code)
+{
+  // Number of errors of code, reported or not.
+  if (code <= kNoError || code >= kNumCodes) return 0;
+  return gCounts[code];
+}
+
+//______________________________________________________________________________
+void TWaveformDiagnostics::ResetCounts()
+{
+  Lock lock;
+  for (int i=0;i<kNumCodes;i++) {
+    gCounts[i] = 0;
+    gSuppressed[i] = 0;
+    gSuppressedUntil[i] = 0;
+  }
+}
+
+//______________________________________________________________________________
+const char* TWaveformDiagnostics::GetCodeName(ECode code)
+{
+  switch (code) {
+    case kNoError: return "NoError";
+    case kNotSimilar: return "NotSimilar";
+    case kTimeOutOfRange: return "TimeOutOfRange";
+    case kIndexOutOfRange: return "IndexOutOfRange";
+    case kFrequencyMismatch: return "FrequencyMismatch";
+    case kWrongLength: return "WrongLength";
+    case kNullInput: return "NullInput";
+    case kNotConfigured: return "NotConfigured";
+    case kWrongType: return "WrongType";
+    case kInvalidParameter: return "InvalidParameter";
+    default: return "Unknown";
+  }
+}
@@ -0,0 +1,74 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformDiagnostics.hh
+ *
+ * DESCRIPTION:
+ *
+ * Error codes, counts and a pluggable, rate-limited sink for the errors
+ * of the waveform operations.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformDiagnostics_hh
+#define WAVE_TWaveformDiagnostics_hh
+
+#include "Rtypes.h"
+
+class TWaveformDiagnostics
+{
+  public:
+    enum ECode {
+      kNoError = 0,
+      kNotSimilar,         // arithmetic on waveforms that are not similar
+      kTimeOutOfRange,     // GetIndexAtTime outside of the waveform
+      kIndexOutOfRange,    // GetTimeAtIndex past the end
+      kFrequencyMismatch,  // Append of a different sampling frequency
+      kWrongLength,        // FFT called with the wrong length, or a
+                           // transformer changed the length
+      kNullInput,          // NULL waveform given to a transformer
+      kNotConfigured,      // transformer used before it was set up
+      kWrongType,          // data decoded into a different sample type
+      kInvalidParameter,   // parameter out of the supported range
+      kNumCodes
+    };
+
+    // Receives the reports that pass the rate limit.
+    class Sink
+    {
+      public:
+        virtual ~Sink() {}
+        virtual void Report(ECode code, const char* message) = 0;
+    };
+
+    // Count an error and pass it to the sink.  Called on failure only.
+    static void Report(ECode code, const char* message);
+
+    // The sink is not owned, NULL restores the default (std::cerr).
+    static void SetSink(Sink* sink);
+    static Sink* GetSink();
+    // Silenced errors are only counted.
+    static void SetSilent(bool silent) { fSilent = silent; }
+    static bool IsSilent() { return fSilent; }
+    // Maximum reports per second and code passed to the sink (default 10),
+    // 0 for no limit.
+    static void SetRateLimit(size_t maxPerSecond) { fRateLimit = maxPerSecond; }
+    static size_t GetRateLimit() { return fRateLimit; }
+
+    // Number of errors of a code since the last ResetCounts, including
+    // suppressed ones.
+    static ULong64_t GetCount(ECode code);
+    static void ResetCounts();
+    static const char* GetCodeName(ECode code);
+
+  private:
+    static bool   fSilent;
+    static size_t fRateLimit;
+};
+
+#endif /* WAVE_TWaveformDiagnostics_hh */
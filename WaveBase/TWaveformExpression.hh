@@ -0,0 +1,279 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformExpression.hh
+ *
+ * DESCRIPTION:
+ *
+ * Expression templates for TTemplWaveform arithmetic: binary operators
+ * build an expression, which is evaluated lazily in one loop when it is
+ * assigned to a waveform.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformExpression_hh
+#define WAVE_TWaveformExpression_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+
+#ifndef __CINT__
+//______________________________________________________________________________
+//
+//  Usage:
+//
+//    #include "TWaveformExpression.hh"
+//    ...
+//    out = (raw - baseline)*gain + offset;
+//
+//  where raw, baseline and offset are waveforms (of any sample type) and
+//  gain a double.  No temporary waveforms are made: the right-hand side is
+//  evaluated sample by sample in a single (vectorizable) loop, and the
+//  waveforms in it are checked for similarity (see IsSimilarTo()) only
+//  once, at the assignment.  out takes the length, sampling frequency and
+//  time offset of the waveforms in the expression, and may itself appear
+//  in the expression.
+//
+//  Real samples are combined in double precision, or complex<double> if
+//  a complex waveform takes part, and converted to the sample type of out
+//  at the end.
+//______________________________________________________________________________
+
+// Type in which two operands are combined
+template<typename _A, typename _B> struct TWaveformPromote 
+  { typedef double Type; };
+template<typename _A> struct TWaveformPromote<std::complex<double>, _A> 
+  { typedef std::complex<double> Type; };
+template<typename _B> struct TWaveformPromote<_B, std::complex<double> > 
+  { typedef std::complex<double> Type; };
+template<> struct TWaveformPromote<std::complex<double>, std::complex<double> > 
+  { typedef std::complex<double> Type; };
+
+// Length, frequency and time offset shared by the waveforms of an expression
+struct TWaveformShape 
+{
+  TWaveformShape() : fSet(false), fSimilar(true), fLength(0), fFreq(0), fTOffset(0) {}
+  template<typename _Tp>
+  void Add(const TTemplWaveform<_Tp>& wf)
+  {
+    if (!fSet) {
+      fSet = true;
+      fLength = wf.GetLength();
+      fFreq = wf.GetSamplingFreq();
+      fTOffset = wf.GetTOffset();
+    } else if (fLength != wf.GetLength() || fFreq != wf.GetSamplingFreq() || 
+               fTOffset != wf.GetTOffset()) {
+      fSimilar = false;
+    }
+  }
+  bool   fSet;
+  bool   fSimilar;
+  size_t fLength;
+  double fFreq;
+  double fTOffset;
+};
+
+// Leaf: a waveform.  Bind() caches the data pointer before the loop.
+template<typename _Tp>
+class TWaveformTerm
+{
+  public:
+    typedef _Tp value_type;
+    TWaveformTerm(const TTemplWaveform<_Tp>& wf) : fWF(&wf), fData(NULL) {}
+    void GetShape(TWaveformShape& shape) const { shape.Add(*fWF); }
+    void Bind() { fData = fWF->GetData(); }
+    value_type operator[](size_t i) const { return fData[i]; }
+  private:
+    const TTemplWaveform<_Tp>* fWF;
+    const _Tp*                 fData;
+};
+
+// Leaf: a scalar
+class TWaveformScalarTerm
+{
+  public:
+    typedef double value_type;
+    TWaveformScalarTerm(double value) : fValue(value) {}
+    void GetShape(TWaveformShape&) const {}
+    void Bind() {}
+    value_type operator[](size_t) const { return fValue; }
+  private:
+    double fValue;
+};
+
+struct TWaveformAddOp {
+  template<typename _R, typename _A, typename _B> 
+  static _R Apply(const _A& a, const _B& b) { return _R(a) + _R(b); }
+};
+struct TWaveformSubOp {
+  template<typename _R, typename _A, typename _B> 
+  static _R Apply(const _A& a, const _B& b) { return _R(a) - _R(b); }
+};
+struct TWaveformMulOp {
+  template<typename _R, typename _A, typename _B> 
+  static _R Apply(const _A& a, const _B& b) { return _R(a) * _R(b); }
+};
+struct TWaveformDivOp {
+  template<typename _R, typename _A, typename _B> 
+  static _R Apply(const _A& a, const _B& b) { return _R(a) / _R(b); }
+};
+
+template<class _L, class _R, class _Op>
+class TWaveformBinaryTerm
+{
+  public:
+    typedef typename TWaveformPromote<typename _L::value_type, 
+                                      typename _R::value_type>::Type value_type;
+    TWaveformBinaryTerm(const _L& l, const _R& r) : fL(l), fR(r) {}
+    void GetShape(TWaveformShape& shape) const { fL.GetShape(shape); fR.GetShape(shape); }
+    void Bind() { fL.Bind(); fR.Bind(); }
+    value_type operator[](size_t i) const 
+      { return _Op::template Apply<value_type>(fL[i], fR[i]); }
+  private:
+    _L fL;
+    _R fR;
+};
+
+template<class _E>
+class TWaveformNegateTerm
+{
+  public:
+    typedef typename TWaveformPromote<typename _E::value_type, double>::Type value_type;
+    TWaveformNegateTerm(const _E& e) : fE(e) {}
+    void GetShape(TWaveformShape& shape) const { fE.GetShape(shape); }
+    void Bind() { fE.Bind(); }
+    value_type operator[](size_t i) const { return -value_type(fE[i]); }
+  private:
+    _E fE;
+};
+
+// Wrapper marking an expression, the operators below only match these and
+// waveforms.
+template<class _Expr>
+class TWaveformExpr
+{
+  public:
+    typedef typename _Expr::value_type value_type;
+    TWaveformExpr(const _Expr& expr) : fExpr(expr) {}
+    const _Expr& GetExpression() const { return fExpr; }
+    void GetShape(TWaveformShape& shape) const { fExpr.GetShape(shape); }
+  private:
+    _Expr fExpr;
+};
+
+#define TWAVEFORM_EXPR_OPERATOR(aOp, aOpClass)                                             \
+template<typename _A, typename _B>                                                         \
+inline TWaveformExpr<TWaveformBinaryTerm<TWaveformTerm<_A>, TWaveformTerm<_B>, aOpClass> > \
+aOp(const TTemplWaveform<_A>& a, const TTemplWaveform<_B>& b)                              \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<TWaveformTerm<_A>, TWaveformTerm<_B>, aOpClass> E;           \
+  return TWaveformExpr<E>(E(TWaveformTerm<_A>(a), TWaveformTerm<_B>(b)));                  \
+}                                                                                          \
+template<class _E, typename _B>                                                            \
+inline TWaveformExpr<TWaveformBinaryTerm<_E, TWaveformTerm<_B>, aOpClass> >                \
+aOp(const TWaveformExpr<_E>& a, const TTemplWaveform<_B>& b)                               \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<_E, TWaveformTerm<_B>, aOpClass> E;                          \
+  return TWaveformExpr<E>(E(a.GetExpression(), TWaveformTerm<_B>(b)));                     \
+}                                                                                          \
+template<typename _A, class _E>                                                            \
+inline TWaveformExpr<TWaveformBinaryTerm<TWaveformTerm<_A>, _E, aOpClass> >                \
+aOp(const TTemplWaveform<_A>& a, const TWaveformExpr<_E>& b)                               \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<TWaveformTerm<_A>, _E, aOpClass> E;                          \
+  return TWaveformExpr<E>(E(TWaveformTerm<_A>(a), b.GetExpression()));                     \
+}                                                                                          \
+template<class _EA, class _EB>                                                             \
+inline TWaveformExpr<TWaveformBinaryTerm<_EA, _EB, aOpClass> >                             \
+aOp(const TWaveformExpr<_EA>& a, const TWaveformExpr<_EB>& b)                              \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<_EA, _EB, aOpClass> E;                                       \
+  return TWaveformExpr<E>(E(a.GetExpression(), b.GetExpression()));                        \
+}                                                                                          \
+template<typename _A>                                                                      \
+inline TWaveformExpr<TWaveformBinaryTerm<TWaveformTerm<_A>, TWaveformScalarTerm, aOpClass> > \
+aOp(const TTemplWaveform<_A>& a, double b)                                                 \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<TWaveformTerm<_A>, TWaveformScalarTerm, aOpClass> E;         \
+  return TWaveformExpr<E>(E(TWaveformTerm<_A>(a), TWaveformScalarTerm(b)));                \
+}                                                                                          \
+template<typename _B>                                                                      \
+inline TWaveformExpr<TWaveformBinaryTerm<TWaveformScalarTerm, TWaveformTerm<_B>, aOpClass> > \
+aOp(double a, const TTemplWaveform<_B>& b)                                                 \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<TWaveformScalarTerm, TWaveformTerm<_B>, aOpClass> E;         \
+  return TWaveformExpr<E>(E(TWaveformScalarTerm(a), TWaveformTerm<_B>(b)));                \
+}                                                                                          \
+template<class _E>                                                                         \
+inline TWaveformExpr<TWaveformBinaryTerm<_E, TWaveformScalarTerm, aOpClass> >              \
+aOp(const TWaveformExpr<_E>& a, double b)                                                  \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<_E, TWaveformScalarTerm, aOpClass> E;                        \
+  return TWaveformExpr<E>(E(a.GetExpression(), TWaveformScalarTerm(b)));                   \
+}                                                                                          \
+template<class _E>                                                                         \
+inline TWaveformExpr<TWaveformBinaryTerm<TWaveformScalarTerm, _E, aOpClass> >              \
+aOp(double a, const TWaveformExpr<_E>& b)                                                  \
+{                                                                                          \
+  typedef TWaveformBinaryTerm<TWaveformScalarTerm, _E, aOpClass> E;                        \
+  return TWaveformExpr<E>(E(TWaveformScalarTerm(a), b.GetExpression()));                   \
+}
+
+TWAVEFORM_EXPR_OPERATOR(operator+, TWaveformAddOp)
+TWAVEFORM_EXPR_OPERATOR(operator-, TWaveformSubOp)
+TWAVEFORM_EXPR_OPERATOR(operator*, TWaveformMulOp)
+TWAVEFORM_EXPR_OPERATOR(operator/, TWaveformDivOp)
+
+#undef TWAVEFORM_EXPR_OPERATOR
+
+template<typename _A>
+inline TWaveformExpr<TWaveformNegateTerm<TWaveformTerm<_A> > >
+operator-(const TTemplWaveform<_A>& a)
+{
+  typedef TWaveformNegateTerm<TWaveformTerm<_A> > E;
+  return TWaveformExpr<E>(E(TWaveformTerm<_A>(a)));
+}
+
+template<class _E>
+inline TWaveformExpr<TWaveformNegateTerm<_E> >
+operator-(const TWaveformExpr<_E>& a)
+{
+  typedef TWaveformNegateTerm<_E> E;
+  return TWaveformExpr<E>(E(a.GetExpression()));
+}
+
+//______________________________________________________________________________
+template<typename _Tp>
+template<class _Expr>
+TTemplWaveform<_Tp>& TTemplWaveform<_Tp>::operator=( const TWaveformExpr<_Expr>& expr )
+{
+  // Evaluate expr into this waveform.  The waveforms in expr must be similar
+  // or this function will return without doing anything.
+  TWaveformShape shape;
+  expr.GetShape(shape);
+  if (!shape.fSimilar) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kNotSimilar, "Waveforms are not similar");
+    return *this;
+  }
+  SetLength(shape.fLength);
+  fSampleFreq = shape.fFreq;
+  fTOffset = shape.fTOffset;
+
+  // Data pointers are taken after the resize, in a local copy of the tree
+  _Expr e(expr.GetExpression());
+  e.Bind();
+  _Tp* out = GetData();
+  const size_t n = shape.fLength;
+  for (size_t i=0;i<n;i++) out[i] = static_cast<_Tp>(e[i]);
+  return *this;
+}
+
+#endif /* __CINT__ */
+
+#endif /* WAVE_TWaveformExpression_hh */
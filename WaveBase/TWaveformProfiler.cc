@@ -0,0 +1,376 @@
+#include "TWaveformProfiler.hh"
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+//______________________________________________________________________________
+//
+//  TWaveformProfiler
+//
+//  Always-on instrumentation of the library: TVWaveformTransformer::Transform
+//  and TransformBatch count calls, samples and real time per transformer
+//  name, and TFastFourierTransformFFTW counts transforms, samples, execution
+//  time, plans made and planning time per length.  The report is printed
+//  with
+//
+//    TWaveformProfiler::Print();                   // C++
+//    print(ROOT.TWaveformProfiler.GetReport())     # PyROOT
+//
+//  and the counters are available with Get*Statistics.
+//
+//  Every thread counts into its own copy of the counters (allocated on its
+//  first call of each transformer or FFT length), so calls and samples are
+//  counted exactly with plain additions and threads running the same
+//  transformer do not contend.  Get*Statistics and Print sum the copies of
+//  all threads, including those that exited, under the lock of the registry,
+//  which is only taken when counters are made or read.  Reading the clock
+//  costs more (20 to 100 ns per call depending on the system), so only one
+//  call in GetSamplingInterval() per thread is timed and the total time is
+//  extrapolated from those (GetTime).  A call then costs 10 to 30 ns in any
+//  number of threads, below 1% for transforms of a thousand samples or more.
+//  Use SetSamplingInterval(1) to time every call, SetEnabled(false) to
+//  switch the counting off, or compile with -DWAVE_NO_PROFILING to remove
+//  it.
+//______________________________________________________________________________
+
+#ifndef WAVE_NO_PROFILING
+bool TWaveformProfiler::fEnabled = true;
+#else
+bool TWaveformProfiler::fEnabled = false;
+#endif
+ULong64_t TWaveformProfiler::fSamplingMask = 15;
+
+namespace {
+  typedef TWaveformProfiler::Counters Counters;
+  typedef TWaveformProfiler::CounterId CounterId;
+  typedef std::map<std::string, CounterId> TransformerMap;
+  typedef std::map<size_t, CounterId> FFTMap;
+
+  // The counters of one thread, in chunks of kChunkSize ids which never
+  // move, so that readers can sum them while the thread updates them.
+  const size_t kChunkSize = 64;
+  const size_t kMaxChunks = 256;
+  struct ThreadCounters {
+    Counters* fChunks[kMaxChunks];
+  };
+
+  // Registry, only locked when counters are made or read
+  pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+  TransformerMap gTransformers;
+  FFTMap gFFTs;
+  CounterId gNextId = 1;
+  std::vector<ThreadCounters*> gThreads;  // live threads
+  std::vector<Counters> gRetired;         // by id, of the exited threads
+  std::vector<Counters> gBaseline;        // by id, totals at the last Reset
+
+  pthread_once_t gKeyOnce = PTHREAD_ONCE_INIT;
+  pthread_key_t gKey;
+
+  class Lock
+  {
+    public:
+      Lock() { pthread_mutex_lock(&gMutex); }
+      ~Lock() { pthread_mutex_unlock(&gMutex); }
+  };
+
+  void Zero(Counters& counters)
+  {
+    counters.fCalls = counters.fSamples = 0;
+    counters.fTimedCalls = counters.fTime = 0;
+    counters.fPlans = counters.fPlanningTime = 0;
+  }
+
+  void Add(Counters& sum, const Counters& counters)
+  {
+    sum.fCalls += counters.fCalls;
+    sum.fSamples += counters.fSamples;
+    sum.fTimedCalls += counters.fTimedCalls;
+    sum.fTime += counters.fTime;
+    sum.fPlans += counters.fPlans;
+    sum.fPlanningTime += counters.fPlanningTime;
+  }
+
+  void Subtract(Counters& sum, const Counters& counters)
+  {
+    sum.fCalls -= counters.fCalls;
+    sum.fSamples -= counters.fSamples;
+    sum.fTimedCalls -= counters.fTimedCalls;
+    sum.fTime -= counters.fTime;
+    sum.fPlans -= counters.fPlans;
+    sum.fPlanningTime -= counters.fPlanningTime;
+  }
+
+  void ThreadExit(void* data)
+  {
+    // Move the counters of an exiting thread to gRetired.
+    ThreadCounters* thread = static_cast<ThreadCounters*>(data);
+    Lock lock;
+    for (size_t chunk=0;chunk<kMaxChunks;chunk++) {
+      if (thread->fChunks[chunk] == NULL) continue;
+      for (size_t i=0;i<kChunkSize;i++) {
+        const size_t id = chunk*kChunkSize + i;
+        if (id < gRetired.size()) Add(gRetired[id], thread->fChunks[chunk][i]);
+      }
+      delete [] thread->fChunks[chunk];
+    }
+    for (size_t i=0;i<gThreads.size();i++) {
+      if (gThreads[i] == thread) {
+        gThreads[i] = gThreads.back();
+        gThreads.pop_back();
+        break;
+      }
+    }
+    delete thread;
+  }
+
+  void MakeKey() { pthread_key_create(&gKey, ThreadExit); }
+
+  CounterId NewId()
+  {
+    // Called with gMutex held.  Ids run out after kMaxChunks*kChunkSize - 1
+    // transformer names and FFT lengths; the further ones are not counted.
+    pthread_once(&gKeyOnce, MakeKey);
+    if (gNextId >= kMaxChunks*kChunkSize) return 0;
+    Counters zero;
+    Zero(zero);
+    gRetired.resize(gNextId + 1, zero);
+    gBaseline.resize(gNextId + 1, zero);
+    return gNextId++;
+  }
+
+  Counters& NewLocal(CounterId id)
+  {
+    // Allocate the counters of id in the calling thread.
+    ThreadCounters* thread = static_cast<ThreadCounters*>(pthread_getspecific(gKey));
+    Lock lock;
+    if (thread == NULL) {
+      thread = new ThreadCounters;
+      for (size_t chunk=0;chunk<kMaxChunks;chunk++) thread->fChunks[chunk] = NULL;
+      gThreads.push_back(thread);
+      pthread_setspecific(gKey, thread);
+    }
+    Counters* chunk = new Counters[kChunkSize];
+    for (size_t i=0;i<kChunkSize;i++) Zero(chunk[i]);
+    thread->fChunks[id/kChunkSize] = chunk;
+    return chunk[id%kChunkSize];
+  }
+
+  inline Counters& Local(CounterId id)
+  {
+    // The counters of id in the calling thread.  An id comes from the
+    // registry, so gKey exists.
+    ThreadCounters* thread = static_cast<ThreadCounters*>(pthread_getspecific(gKey));
+    if (thread != NULL) {
+      Counters* chunk = thread->fChunks[id/kChunkSize];
+      if (chunk != NULL) return chunk[id%kChunkSize];
+    }
+    return NewLocal(id);
+  }
+
+  Counters Total(CounterId id)
+  {
+    // Called with gMutex held.  Sum of all threads since the last Reset.
+    Counters sum;
+    Zero(sum);
+    if (id == 0 || id >= gRetired.size()) return sum;
+    sum = gRetired[id];
+    for (size_t i=0;i<gThreads.size();i++) {
+      const Counters* chunk = gThreads[i]->fChunks[id/kChunkSize];
+      if (chunk != NULL) Add(sum, chunk[id%kChunkSize]);
+    }
+    Subtract(sum, gBaseline[id]);
+    return sum;
+  }
+
+  void PrintTime(std::ostream& os, double seconds)
+  {
+    char buf[32];
+    snprintf(buf, sizeof(buf), " %12.6f", seconds);
+    os << buf;
+  }
+}
+
+//______________________________________________________________________________
+TWaveformProfiler::CounterId TWaveformProfiler::GetTransformerCounters(const std::string& name)
+{
+  // Counters of the transformers called name.  Transformers look them up
+  // once and keep the id.
+  Lock lock;
+  CounterId& id = gTransformers[name];
+  if (id == 0) id = NewId();
+  return id;
+}
+
+//______________________________________________________________________________
+TWaveformProfiler::CounterId TWaveformProfiler::GetFFTCounters(size_t length)
+{
+  // Counters of the FFTs of length samples.
+  Lock lock;
+  CounterId& id = gFFTs[length];
+  if (id == 0) id = NewId();
+  return id;
+}
+
+//______________________________________________________________________________
+void TWaveformProfiler::SetSamplingInterval(size_t interval)
+{
+  // Time one call in interval, rounded up to a power of two.
+  ULong64_t n = 1;
+  while (n < interval) n *= 2;
+  fSamplingMask = n - 1;
+}
+
+//______________________________________________________________________________
+ULong64_t TWaveformProfiler::Start(CounterId counters, size_t calls, size_t samples)
+{
+  // Count calls and samples in the calling thread.  Returns Now() for one
+  // call in the sampling interval (i.e. when the call count of the thread
+  // crosses a multiple of it), 0 otherwise.
+  if (counters == 0) return 0;
+  Counters& local = Local(counters);
+  local.fSamples += samples;
+  const ULong64_t before = local.fCalls - 1;
+  local.fCalls += calls;
+  if ((before & ~fSamplingMask) == ((before + calls) & ~fSamplingMask)) return 0;
+  return Now();
+}
+
+//______________________________________________________________________________
+void TWaveformProfiler::Stop(CounterId counters, ULong64_t start, size_t calls)
+{
+  // Add the time since start (from Start in the same thread) of calls calls
+  // to counters.
+  ULong64_t stop = Now();
+  Counters& local = Local(counters);
+  local.fTimedCalls += calls;
+  local.fTime += stop - start;
+}
+
+//______________________________________________________________________________
+void TWaveformProfiler::AddPlan(CounterId counters, ULong64_t time)
+{
+  // Record one FFT plan made in time ns.
+  if (counters == 0) return;
+  Counters& local = Local(counters);
+  local.fPlans++;
+  local.fPlanningTime += time;
+}
+
+//______________________________________________________________________________
+double TWaveformProfiler::GetTime(const Counters& counters)
+{
+  // Total time of all calls, extrapolated from the timed ones.
+  if (counters.fTimedCalls == 0) return 0.;
+  return 1e-9*counters.fTime*counters.fCalls/counters.fTimedCalls;
+}
+
+//______________________________________________________________________________
+ULong64_t TWaveformProfiler::Now()
+{
+  // Monotonic time in ns, never 0.
+#ifdef CLOCK_MONOTONIC
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1000000000ULL*ts.tv_sec + ts.tv_nsec + 1;
+#else
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return 1000000000ULL*tv.tv_sec + 1000ULL*tv.tv_usec + 1;
+#endif
+}
+
+//______________________________________________________________________________
+std::vector<std::string> TWaveformProfiler::GetTransformerNames()
+{
+  // Names of all transformers used so far, sorted.
+  Lock lock;
+  std::vector<std::string> names;
+  for (TransformerMap::const_iterator iter = gTransformers.begin();
+       iter != gTransformers.end(); iter++) names.push_back(iter->first);
+  return names;
+}
+
+//______________________________________________________________________________
+TWaveformProfiler::Counters TWaveformProfiler::GetTransformerStatistics(const std::string& name)
+{
+  // Counters of the transformers called name, summed over all threads.
+  const CounterId id = GetTransformerCounters(name);
+  Lock lock;
+  return Total(id);
+}
+
+//______________________________________________________________________________
+std::vector<size_t> TWaveformProfiler::GetFFTLengths()
+{
+  // Lengths of all FFTs used so far, sorted.
+  Lock lock;
+  std::vector<size_t> lengths;
+  for (FFTMap::const_iterator iter = gFFTs.begin(); iter != gFFTs.end(); iter++) {
+    lengths.push_back(iter->first);
+  }
+  return lengths;
+}
+
+//______________________________________________________________________________
+TWaveformProfiler::Counters TWaveformProfiler::GetFFTStatistics(size_t length)
+{
+  // Counters of the FFTs of length samples, summed over all threads.
+  const CounterId id = GetFFTCounters(length);
+  Lock lock;
+  return Total(id);
+}
+
+//______________________________________________________________________________
+void TWaveformProfiler::Reset()
+{
+  // Zero all counters (they stay valid).  The counters of the threads are
+  // only written by their thread, so the current totals are kept as the
+  // baseline of the following statistics instead.
+  Lock lock;
+  for (CounterId id=1;id<gBaseline.size();id++) Add(gBaseline[id], Total(id));
+}
+
+//______________________________________________________________________________
+void TWaveformProfiler::Print(std::ostream& os)
+{
+  // Table of the counters of all transformers and FFTs that were used.
+  Lock lock;
+  char buf[128];
+  os << "Transformer                         Calls           Samples     Time [s]" << std::endl;
+  for (TransformerMap::const_iterator iter = gTransformers.begin();
+       iter != gTransformers.end(); iter++) {
+    const Counters c = Total(iter->second);
+    if (c.fCalls == 0) continue;
+    snprintf(buf, sizeof(buf), "%-28s %12llu %17llu", iter->first.c_str(),
+             (unsigned long long)c.fCalls, (unsigned long long)c.fSamples);
+    os << buf;
+    PrintTime(os, GetTime(c));
+    os << std::endl;
+  }
+  os << std::endl
+     << "FFT length                          Calls           Samples     Time [s]"
+     << "    Plans Planning [s]" << std::endl;
+  for (FFTMap::const_iterator iter = gFFTs.begin(); iter != gFFTs.end(); iter++) {
+    const Counters c = Total(iter->second);
+    if (c.fCalls == 0 && c.fPlans == 0) continue;
+    snprintf(buf, sizeof(buf), "%-28lu %12llu %17llu", (unsigned long)iter->first,
+             (unsigned long long)c.fCalls, (unsigned long long)c.fSamples);
+    os << buf;
+    PrintTime(os, GetTime(c));
+    snprintf(buf, sizeof(buf), " %8llu", (unsigned long long)c.fPlans);
+    os << buf;
+    PrintTime(os, 1e-9*c.fPlanningTime);
+    os << std::endl;
+  }
+}
+
+//______________________________________________________________________________
+std::string TWaveformProfiler::GetReport()
+{
+  // The table of Print as a string, e.g. for PyROOT.
+  std::ostringstream os;
+  Print(os);
+  return os.str();
+}
@@ -0,0 +1,101 @@
+/**
+ *
+ * CLASS DECLARATION:  TWaveformProfiler.hh
+ *
+ * DESCRIPTION:
+ *
+ * Library-wide counters of calls, samples and time of the waveform
+ * transformers (per name) and of the FFTs (per length).
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWaveformProfiler_hh
+#define WAVE_TWaveformProfiler_hh
+
+#include "Rtypes.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+class TWaveformProfiler
+{
+  public:
+    struct Counters {
+      ULong64_t fCalls;
+      ULong64_t fSamples;
+      ULong64_t fTimedCalls;    // calls included in fTime
+      ULong64_t fTime;          // ns (real time) of fTimedCalls calls
+      ULong64_t fPlans;         // FFTs only
+      ULong64_t fPlanningTime;  // ns, FFTs only
+    };
+
+    // Profiling is on by default; compile with -DWAVE_NO_PROFILING to
+    // remove it completely.
+#ifndef WAVE_NO_PROFILING
+    static void SetEnabled(bool enable) { fEnabled = enable; }
+    static bool IsEnabled() { return fEnabled; }
+#else
+    static void SetEnabled(bool) {}
+    static bool IsEnabled() { return false; }
+#endif
+
+    // Identifies the counters of a transformer name or FFT length; 0 is
+    // none (nothing is counted).  Each thread updates its own copy of the
+    // counters, which are summed by Get*Statistics and Print.
+    typedef UInt_t CounterId;
+
+    // Made on first use and valid for the lifetime of the program.
+    static CounterId GetTransformerCounters(const std::string& name);
+    static CounterId GetFFTCounters(size_t length);
+
+    // Only one call in interval (rounded up to a power of two, default 16)
+    // is timed, calls and samples are always counted.
+    static void SetSamplingInterval(size_t interval);
+    static size_t GetSamplingInterval() { return fSamplingMask + 1; }
+
+    // Count calls and samples, and return the start time if this call is
+    // timed (otherwise 0), to be passed to Stop.
+    static ULong64_t Start(CounterId counters, size_t calls, size_t samples);
+    static void Stop(CounterId counters, ULong64_t start, size_t calls = 1);
+    static void AddPlan(CounterId counters, ULong64_t time);
+    // Monotonic clock in ns, never 0
+    static ULong64_t Now();
+    // Estimated total time in seconds of all calls of counters
+    static double GetTime(const Counters& counters);
+
+    // Snapshots of the counters
+    static std::vector<std::string> GetTransformerNames();
+    static Counters GetTransformerStatistics(const std::string& name);
+    static std::vector<size_t> GetFFTLengths();
+    static Counters GetFFTStatistics(size_t length);
+
+    static void Reset();
+    static void Print(std::ostream& os = std::cout);
+    static std::string GetReport();
+
+    // Times the lifetime of the object into counters when profiling is
+    // enabled, e.g. the execution of a transform.
+    class ScopedTimer
+    {
+      public:
+        ScopedTimer(CounterId counters, size_t samples) :
+          fCounters(counters),
+          fStart((counters != 0 && IsEnabled()) ? Start(counters, 1, samples) : 0) {}
+        ~ScopedTimer() { if (fStart != 0) Stop(fCounters, fStart); }
+      private:
+        CounterId fCounters;
+        ULong64_t fStart;
+    };
+
+  private:
+    static bool fEnabled;
+    static ULong64_t fSamplingMask;
+};
+
+#endif /* WAVE_TWaveformProfiler_hh */
@@ -0,0 +1,57 @@
+#include "TWaveformStreamChain.hh"
+
+//______________________________________________________________________________
+// TWaveformStreamChain
+// 
+// Feeds chunks of a trace through a list of TVWaveformStreamTransformer
+// stages.  Intermediate results are held in two scratch waveforms of
+// roughly chunk size, so the memory used does not depend on the length of
+// the trace:
+//
+//   TWaveformStreamChain chain;
+//   chain.AddStage(&filter);
+//   chain.AddStage(&average);
+//   chain.Reset();
+//   while (...) { chain.Process(chunk, out); ... }
+//   chain.Finish(out);
+
+void TWaveformStreamChain::Reset()
+{
+  for (size_t i=0;i<fStages.size();i++) fStages[i]->Reset();
+}
+
+void TWaveformStreamChain::Process(const TDoubleWaveform& chunk, TDoubleWaveform& output)
+{
+  if (fStages.size() == 0) {
+    output = chunk;
+    return;
+  }
+  const TDoubleWaveform* current = &chunk;
+  for (size_t i=0;i<fStages.size();i++) {
+    TDoubleWaveform* next = (i+1 == fStages.size()) ? &output : &fTmp[i%2];
+    fStages[i]->Process(*current, *next);
+    current = next;
+  }
+}
+
+void TWaveformStreamChain::Finish(TDoubleWaveform& output)
+{
+  // Flush every stage in turn, passing what it still holds through the
+  // stages that follow it.
+  output.SetLength(0);
+  bool empty = true;
+  for (size_t i=0;i<fStages.size();i++) {
+    fStages[i]->Finish(fFlush);
+    for (size_t j=i+1;j<fStages.size();j++) {
+      fStages[j]->Process(fFlush, fTmp[0]);
+      fFlush = fTmp[0];
+    }
+    if (fFlush.GetLength() == 0) continue;
+    if (empty) {
+      output = fFlush;
+      empty = false;
+    } else {
+      output.Append(fFlush);
+    }
+  }
+}
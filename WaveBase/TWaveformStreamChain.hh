@@ -0,0 +1,44 @@
+/**                                                            
+ *      
+ * CLASS DECLARATION:  TWaveformStreamChain.hh
+ *
+ * DESCRIPTION: 
+ *
+ * Runs chunks of a long trace through a sequence of stream transformers.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT: 
+ * FIRST SUBMISSION: 
+ * 
+ * REVISION:
+ * 
+ */
+
+#ifndef WAVE_TWaveformStreamChain_hh
+#define WAVE_TWaveformStreamChain_hh
+
+#ifndef WAVE_TVWaveformStreamTransformer_hh
+#include "TVWaveformStreamTransformer.hh" 
+#endif
+#include <vector>
+
+class TWaveformStreamChain
+{
+  public:
+    TWaveformStreamChain() {}
+
+    // Stages are not owned and are run in the order they were added.
+    void AddStage(TVWaveformStreamTransformer* stage) { fStages.push_back(stage); }
+    size_t GetNumberOfStages() const { return fStages.size(); }
+
+    void Reset();
+    void Process(const TDoubleWaveform& chunk, TDoubleWaveform& output);
+    void Finish(TDoubleWaveform& output);
+
+  protected:
+    std::vector<TVWaveformStreamTransformer*> fStages;
+    TDoubleWaveform fTmp[2];
+    TDoubleWaveform fFlush;
+};
+
+#endif /* WAVE_TWaveformStreamChain_hh */
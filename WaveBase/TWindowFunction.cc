@@ -0,0 +1,102 @@
+#include "TWindowFunction.hh"
+#include "TMath.h"
+//______________________________________________________________________________
+//
+//  TWindowFunction
+//
+//  Window functions for spectral analysis, cached per type and length in
+//  the same way as the FFTs of TFastFourierTransformFFTW:
+//
+//    const TWindowFunction& hann = TWindowFunction::Get(TWindowFunction::kHann, 2048);
+//    hann.Apply(wf);
+//
+//  The windows are periodic (DFT-even), i.e. w[n] for n = 0..N-1 are the
+//  first N points of the symmetric window of length N+1, which is the
+//  usual choice for spectral estimation.  The Kaiser window takes its beta
+//  as parameter.  As for GetFFT, the cache is not locked, so Get must be
+//  called from one thread.
+//______________________________________________________________________________
+
+TWindowFunction::WindowMap TWindowFunction::fMap;
+
+//______________________________________________________________________________
+const TWindowFunction& TWindowFunction::Get(EWindow window, size_t length, double param)
+{
+  if (window != kKaiser) param = 0.;
+  Key key(std::make_pair((int)window, length), param);
+  WindowMap::iterator iter = fMap.find(key);
+  if (iter == fMap.end()) {
+    iter = fMap.insert(std::make_pair(key, TWindowFunction())).first;
+    TWindowFunction& w = iter->second;
+    w.fType = window;
+    w.fParam = param;
+    w.fTable.resize(length);
+    w.Build();
+  }
+  return iter->second;
+}
+
+//______________________________________________________________________________
+void TWindowFunction::ClearCache()
+{
+  fMap.clear();
+}
+
+//______________________________________________________________________________
+void TWindowFunction::Build()
+{
+  const size_t N = fTable.size();
+  const double twoPi = 2*TMath::Pi();
+  for (size_t n=0;n<N;n++) {
+    double x = double(n)/N;
+    double w = 1.;
+    switch (fType) {
+      case kHann:     w = 0.5 - 0.5*TMath::Cos(twoPi*x); break;
+      case kHamming:  w = 0.54 - 0.46*TMath::Cos(twoPi*x); break;
+      case kBlackman: w = 0.42 - 0.5*TMath::Cos(twoPi*x) + 0.08*TMath::Cos(2*twoPi*x); break;
+      case kKaiser: {
+        double r = 2*x - 1;
+        w = TMath::BesselI0(fParam*TMath::Sqrt(1 - r*r))/TMath::BesselI0(fParam);
+        break;
+      }
+      default: break;
+    }
+    fTable[n] = w;
+  }
+  fSum = 0.;
+  fSumSquares = 0.;
+  for (size_t n=0;n<N;n++) {
+    fSum += fTable[n];
+    fSumSquares += fTable[n]*fTable[n];
+  }
+}
+
+//______________________________________________________________________________
+void TWindowFunction::Apply(TDoubleWaveform& wf) const
+{
+  if (wf.GetLength() != fTable.size()) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Window and waveform have different lengths");
+    return;
+  }
+  double* x = wf.GetData();
+  const double* w = GetData();
+  const size_t n = fTable.size();
+  for (size_t i=0;i<n;i++) x[i] *= w[i];
+}
+
+//______________________________________________________________________________
+void TWindowFunction::Apply(const TDoubleWaveform& in, TDoubleWaveform& out) const
+{
+  if (in.GetLength() != fTable.size()) {
+    TWaveformDiagnostics::Report(TWaveformDiagnostics::kWrongLength,
+      "Window and waveform have different lengths");
+    return;
+  }
+  out.MakeSimilarTo(in);
+  const double* x = in.GetData();
+  double* y = out.GetData();
+  const double* w = GetData();
+  const size_t n = fTable.size();
+  for (size_t i=0;i<n;i++) y[i] = x[i]*w[i];
+}
@@ -0,0 +1,67 @@
+/**
+ *
+ * CLASS DECLARATION:  TWindowFunction.hh
+ *
+ * DESCRIPTION:
+ *
+ * Cached window function tables (Hann, Hamming, Blackman, Kaiser) for
+ * spectral analysis.
+ *
+ * AUTHOR: M. Marino
+ * CONTACT:
+ * FIRST SUBMISSION:
+ *
+ * REVISION:
+ *
+ */
+
+#ifndef WAVE_TWindowFunction_hh
+#define WAVE_TWindowFunction_hh
+
+#ifndef WAVE_TTemplWaveform_hh
+#include "TTemplWaveform.hh"
+#endif
+#include <map>
+#include <vector>
+
+class TWindowFunction
+{
+  public:
+    enum EWindow { kRectangular, kHann, kHamming, kBlackman, kKaiser };
+
+    // Table of the window of the given length.  param is the beta of the
+    // Kaiser window and is ignored otherwise.  The table is computed once
+    // and the reference stays valid until ClearCache().
+    static const TWindowFunction& Get(EWindow window, size_t length, double param = 0.);
+    static void ClearCache();
+
+    // Multiply wf by the window, wf must have the length of the window.
+    void Apply(TDoubleWaveform& wf) const;
+    // out = window * in.
+    void Apply(const TDoubleWaveform& in, TDoubleWaveform& out) const;
+
+    EWindow GetType() const { return fType; }
+    double GetParam() const { return fParam; }
+    size_t GetLength() const { return fTable.size(); }
+    const double* GetData() const { return fTable.empty() ? NULL : &fTable[0]; }
+    double operator[](size_t i) const { return fTable[i]; }
+    // Sum of w and of w^2, for amplitude and power normalization.
+    double GetSum() const { return fSum; }
+    double GetSumSquares() const { return fSumSquares; }
+
+  protected:
+    typedef std::pair<std::pair<int, size_t>, double> Key;
+    typedef std::map<Key, TWindowFunction> WindowMap;
+    static WindowMap fMap;
+
+    TWindowFunction() : fType(kRectangular), fParam(0.), fSum(0.), fSumSquares(0.) {}
+    void Build();
+
+    EWindow             fType;
+    double              fParam;
+    std::vector<double> fTable;
+    double              fSum;
+    double              fSumSquares;
+};
+
+#endif /* WAVE_TWindowFunction_hh */
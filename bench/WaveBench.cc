@@ -0,0 +1,564 @@
+#include "TTemplWaveform.hh"
+#include "TFastFourierTransformFFTW.hh"
+#include "TExpWindowAverage.hh"
+#include "TFitWaveforms.hh"
+#include "TStopwatch.h"
+#include "TMath.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+//______________________________________________________________________________
+//
+//  WaveBench
+//
+//  Micro and macro benchmarks of the WaveBase library, built and run with
+//
+//    make bench [BENCH_ARGS="--filter=FFT --min_time=0.5"]
+//
+//  Every benchmark is run with an increasing number of iterations until it
+//  takes at least --min_time seconds (as Google Benchmark does), and the
+//  results are written as JSON (--out=file, default stdout) in the layout
+//  of Google Benchmark, with the throughput as samples_per_second and
+//  waveforms_per_second, so that runs of different releases can be
+//  compared with the usual tools.  Progress goes to stderr.
+//
+//  The FFT benchmarks run with every available engine (FFTW and built-in),
+//  at lengths that are powers of two, composite and prime.
+//______________________________________________________________________________
+
+namespace {
+
+  // Results are added here so that the compiler cannot drop the work
+  volatile double gSink = 0.;
+
+  class Benchmark
+  {
+    public:
+      Benchmark(const std::string& name, size_t samples, size_t waveforms = 1) :
+        fName(name), fSamples(samples), fWaveforms(waveforms) {}
+      virtual ~Benchmark() {}
+
+      // Called once before timing
+      virtual void SetUp() {}
+      // Run the measured code iterations times
+      virtual void Run(size_t iterations) = 0;
+
+      const std::string& GetName() const { return fName; }
+      // Samples and waveforms processed by one iteration
+      size_t GetSamples() const { return fSamples; }
+      size_t GetWaveforms() const { return fWaveforms; }
+
+    protected:
+      std::string fName;
+      size_t      fSamples;
+      size_t      fWaveforms;
+  };
+
+  std::string Name(const char* base, const char* type, size_t length)
+  {
+    char buf[256];
+    if (type && type[0]) snprintf(buf, sizeof(buf), "%s<%s>/%lu", base, type, (unsigned long)length);
+    else snprintf(buf, sizeof(buf), "%s/%lu", base, (unsigned long)length);
+    return buf;
+  }
+
+  template<typename _Tp>
+  void Fill(TTemplWaveform<_Tp>& wf, size_t length, unsigned int seed = 1)
+  {
+    // Pulse-like data in the range of every type
+    wf.SetLength(length);
+    srand(seed);
+    for (size_t i=0;i<length;i++) {
+      wf[i] = static_cast<_Tp>(100 + 50*std::sin(0.01*i) + rand() % 20);
+    }
+  }
+
+  //____________________________________________________________________________
+  template<typename _Tp>
+  class ArithmeticBench : public Benchmark
+  {
+    public:
+      ArithmeticBench(const char* type, size_t length) :
+        Benchmark(Name("BM_AddSubtract", type, length), 2*length), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength, 1); Fill(fB, fLength, 2); }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          fA += fB;
+          fA -= fB;
+        }
+        gSink += fA[0];
+      }
+    protected:
+      size_t fLength;
+      TTemplWaveform<_Tp> fA, fB;
+  };
+
+  //____________________________________________________________________________
+  template<typename _Tp>
+  class ScaleBench : public Benchmark
+  {
+    public:
+      ScaleBench(const char* type, size_t length) :
+        Benchmark(Name("BM_Scale", type, length), 2*length), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        // Alternate the factors so that the data stays in range
+        for (size_t i=0;i<iterations;i++) {
+          fA *= 2.0;
+          fA *= 0.5;
+        }
+        gSink += fA[0];
+      }
+    protected:
+      size_t fLength;
+      TTemplWaveform<_Tp> fA;
+  };
+
+  //____________________________________________________________________________
+  template<typename _Tp>
+  class SumBench : public Benchmark
+  {
+    public:
+      SumBench(const char* type, size_t length) :
+        Benchmark(Name("BM_Sum", type, length), length), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        double sum = 0.;
+        for (size_t i=0;i<iterations;i++) sum += fA.Sum();
+        gSink += sum;
+      }
+    protected:
+      size_t fLength;
+      TTemplWaveform<_Tp> fA;
+  };
+
+  //____________________________________________________________________________
+  template<typename _Tp>
+  class StdDevBench : public Benchmark
+  {
+    public:
+      StdDevBench(const char* type, size_t length) :
+        Benchmark(Name("BM_StdDevSquared", type, length), length), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        double sum = 0.;
+        for (size_t i=0;i<iterations;i++) sum += fA.StdDevSquared();
+        gSink += sum;
+      }
+    protected:
+      size_t fLength;
+      TTemplWaveform<_Tp> fA;
+  };
+
+  //____________________________________________________________________________
+  template<typename _From, typename _To>
+  class SetDataBench : public Benchmark
+  {
+    public:
+      SetDataBench(const char* types, size_t length) :
+        Benchmark(Name("BM_SetData", types, length), length), fLength(length) {}
+      virtual void SetUp() { Fill(fFrom, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) fTo.SetData(fFrom.GetData(), fLength);
+        gSink += fTo[0];
+      }
+    protected:
+      size_t fLength;
+      TTemplWaveform<_From> fFrom;
+      TTemplWaveform<_To>   fTo;
+  };
+
+  //____________________________________________________________________________
+  class InterpolateBench : public Benchmark
+  {
+    public:
+      InterpolateBench(size_t length) :
+        Benchmark(Name("BM_InterpolateAtPoint", "", length), length), fLength(length) {}
+      virtual void SetUp()
+      {
+        Fill(fA, fLength);
+        // Times between the samples, in random order
+        fTimes.resize(fLength);
+        for (size_t i=0;i<fLength;i++) {
+          fTimes[i] = fA.GetTimeAtIndex(rand() % (fLength - 1)) + 0.37*fA.GetSamplingPeriod();
+        }
+      }
+      virtual void Run(size_t iterations)
+      {
+        double sum = 0.;
+        for (size_t i=0;i<iterations;i++) {
+          for (size_t j=0;j<fLength;j++) sum += fA.InterpolateAtPoint(fTimes[j]);
+        }
+        gSink += sum;
+      }
+    protected:
+      size_t fLength;
+      TDoubleWaveform fA;
+      std::vector<double> fTimes;
+  };
+
+  //____________________________________________________________________________
+  class RefineBench : public Benchmark
+  {
+    public:
+      RefineBench(size_t length) :
+        Benchmark(Name("BM_Refine4x", "", length), 4*length), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          TDoubleWaveform refined = fA.Refine(4*fA.GetSamplingFreq());
+          gSink += refined[0];
+        }
+      }
+    protected:
+      size_t fLength;
+      TDoubleWaveform fA;
+  };
+
+  //____________________________________________________________________________
+  class SubWaveformBench : public Benchmark
+  {
+    public:
+      SubWaveformBench(size_t length) :
+        Benchmark(Name("BM_SubWaveform", "", length), length/2), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          TShortWaveform sub = fA.SubWaveform(fLength/4, 3*fLength/4);
+          gSink += sub[0];
+        }
+      }
+    protected:
+      size_t fLength;
+      TShortWaveform fA;
+  };
+
+  //____________________________________________________________________________
+  class AppendBench : public Benchmark
+  {
+    public:
+      // Build a trace of 64 chunks
+      AppendBench(size_t length) :
+        Benchmark(Name("BM_Append64", "", length), 64*length, 64), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          TShortWaveform trace;
+          for (size_t j=0;j<64;j++) trace.Append(fA);
+          gSink += trace[0];
+        }
+      }
+    protected:
+      size_t fLength;
+      TShortWaveform fA;
+  };
+
+  //____________________________________________________________________________
+  class FFTBench : public Benchmark
+  {
+    public:
+      FFTBench(TFastFourierTransformFFTW::EEngine engine, bool inverse, size_t length) :
+        Benchmark(Name(inverse ? "BM_PerformInverseFFT" : "BM_PerformFFT",
+                       engine == TFastFourierTransformFFTW::kFFTWEngine ? "fftw" : "builtin",
+                       length), length),
+        fEngine(engine), fInverse(inverse), fLength(length) {}
+      virtual void SetUp()
+      {
+        Fill(fA, fLength);
+        TFastFourierTransformFFTW::SetEngine(fEngine);
+        // Make the plans outside of the timing
+        TFastFourierTransformFFTW::GetFFT(fLength).PerformFFT(fA, fFT);
+        TFastFourierTransformFFTW::GetFFT(fLength).PerformInverseFFT(fA, fFT, true);
+      }
+      virtual void Run(size_t iterations)
+      {
+        TFastFourierTransformFFTW::SetEngine(fEngine);
+        TFastFourierTransformFFTW& fft = TFastFourierTransformFFTW::GetFFT(fLength);
+        for (size_t i=0;i<iterations;i++) {
+          if (fInverse) fft.PerformInverseFFT(fA, fFT);
+          else fft.PerformFFT(fA, fFT);
+        }
+        gSink += fA[0];
+      }
+    protected:
+      TFastFourierTransformFFTW::EEngine fEngine;
+      bool            fInverse;
+      size_t          fLength;
+      TDoubleWaveform fA;
+      TWaveformFT     fFT;
+  };
+
+  //____________________________________________________________________________
+  class ExpWindowBench : public Benchmark
+  {
+    public:
+      ExpWindowBench(size_t length) :
+        Benchmark(Name("BM_TExpWindowAverage", "", length), length), fLength(length) {}
+      virtual void SetUp() { Fill(fA, fLength); fAverage.SetAlpha(0.1); }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          fB = fA;
+          fAverage.Transform(&fB);
+        }
+        gSink += fB[0];
+      }
+    protected:
+      size_t fLength;
+      TExpWindowAverage fAverage;
+      TDoubleWaveform fA, fB;
+  };
+
+  //____________________________________________________________________________
+  class ExpWindowBatchBench : public Benchmark
+  {
+    public:
+      ExpWindowBatchBench(size_t length) :
+        Benchmark(Name("BM_TExpWindowAverageBatch64", "", length), 64*length, 64),
+        fLength(length) {}
+      virtual void SetUp()
+      {
+        fA.resize(64);
+        fB.resize(64);
+        for (size_t j=0;j<64;j++) {
+          Fill(fA[j], fLength, j + 1);
+          fPointers.push_back(&fB[j]);
+        }
+        fAverage.SetAlpha(0.1);
+      }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          for (size_t j=0;j<64;j++) fB[j] = fA[j];
+          fAverage.TransformBatch(fPointers);
+        }
+        gSink += fB[0][0];
+      }
+    protected:
+      size_t fLength;
+      TExpWindowAverage fAverage;
+      std::vector<TDoubleWaveform> fA, fB;
+      std::vector<TDoubleWaveform*> fPointers;
+  };
+
+  //____________________________________________________________________________
+  class FitBench : public Benchmark
+  {
+    public:
+      // Template fit of a shifted copy of a pulse
+      FitBench(size_t length) :
+        Benchmark(Name("BM_TFitWaveforms", "", length), length), fLength(length) {}
+      virtual void SetUp()
+      {
+        fTemplate.SetLength(fLength);
+        fPulse.SetLength(fLength);
+        const double t0 = 0.3*fLength, tau = 0.1*fLength;
+        for (size_t i=0;i<fLength;i++) {
+          double t = i - t0;
+          fTemplate[i] = (t > 0) ? (1 - std::exp(-t/5.))*std::exp(-t/tau) : 0.;
+          t -= 3.3;
+          fPulse[i] = (t > 0) ? (1 - std::exp(-t/5.))*std::exp(-t/tau) : 0.;
+        }
+        fFit.SetFitWaveform(fTemplate);
+      }
+      virtual void Run(size_t iterations)
+      {
+        for (size_t i=0;i<iterations;i++) {
+          fFit.SetInitialOffset(0.);
+          fFit.Transform(&fPulse);
+          gSink += fFit.GetOffset();
+        }
+      }
+    protected:
+      size_t fLength;
+      TFitWaveforms fFit;
+      TDoubleWaveform fTemplate, fPulse;
+  };
+
+  //____________________________________________________________________________
+  std::vector<Benchmark*> MakeBenchmarks()
+  {
+    std::vector<Benchmark*> b;
+    const size_t n = 4096;
+    b.push_back(new ArithmeticBench<Double_t>("double", n));
+    b.push_back(new ArithmeticBench<Float_t>("float", n));
+    b.push_back(new ArithmeticBench<Int_t>("int", n));
+    b.push_back(new ArithmeticBench<Short_t>("short", n));
+    b.push_back(new ArithmeticBench<UShort_t>("ushort", n));
+    b.push_back(new ScaleBench<Double_t>("double", n));
+    b.push_back(new ScaleBench<Short_t>("short", n));
+    b.push_back(new SumBench<Double_t>("double", n));
+    b.push_back(new SumBench<Float_t>("float", n));
+    b.push_back(new SumBench<Int_t>("int", n));
+    b.push_back(new SumBench<Short_t>("short", n));
+    b.push_back(new SumBench<UShort_t>("ushort", n));
+    b.push_back(new StdDevBench<Double_t>("double", n));
+    b.push_back(new StdDevBench<Float_t>("float", n));
+    b.push_back(new StdDevBench<Int_t>("int", n));
+    b.push_back(new StdDevBench<Short_t>("short", n));
+    b.push_back(new StdDevBench<UShort_t>("ushort", n));
+    b.push_back(new SetDataBench<Short_t, Double_t>("short,double", n));
+    b.push_back(new SetDataBench<UShort_t, Double_t>("ushort,double", n));
+    b.push_back(new SetDataBench<Int_t, Double_t>("int,double", n));
+    b.push_back(new SetDataBench<Double_t, Float_t>("double,float", n));
+    b.push_back(new SetDataBench<Double_t, Double_t>("double,double", n));
+    b.push_back(new InterpolateBench(n));
+    b.push_back(new RefineBench(n));
+    b.push_back(new SubWaveformBench(n));
+    b.push_back(new AppendBench(n));
+
+    std::vector<TFastFourierTransformFFTW::EEngine> engines;
+#ifdef HAVE_FFTW
+    engines.push_back(TFastFourierTransformFFTW::kFFTWEngine);
+#endif
+    engines.push_back(TFastFourierTransformFFTW::kBuiltInEngine);
+    // Powers of two, 7-smooth and prime lengths
+    const size_t lengths[] = { 256, 1024, 1000, 1021, 4096, 65536, 65537, 1 << 20 };
+    for (size_t e=0;e<engines.size();e++) {
+      for (size_t l=0;l<sizeof(lengths)/sizeof(lengths[0]);l++) {
+        b.push_back(new FFTBench(engines[e], false, lengths[l]));
+        b.push_back(new FFTBench(engines[e], true, lengths[l]));
+      }
+    }
+
+    b.push_back(new ExpWindowBench(n));
+    b.push_back(new ExpWindowBatchBench(n));
+    b.push_back(new FitBench(512));
+    return b;
+  }
+
+  //____________________________________________________________________________
+  struct Result {
+    std::string fName;
+    size_t      fIterations;
+    double      fRealTime;    // ns per iteration
+    double      fCpuTime;     // ns per iteration
+    double      fSamplesPerSecond;
+    double      fWaveformsPerSecond;
+  };
+
+  Result Measure(Benchmark& bench, double minTime)
+  {
+    // Grow the number of iterations until the run takes minTime
+    bench.SetUp();
+    bench.Run(1);
+    size_t iterations = 1;
+    double real = 0., cpu = 0.;
+    for (;;) {
+      TStopwatch timer;
+      bench.Run(iterations);
+      timer.Stop();
+      real = timer.RealTime();
+      cpu = timer.CpuTime();
+      if (real >= minTime || iterations >= 1000000000) break;
+      // Aim 40% above minTime, at most 10x more iterations per step
+      double factor = (real > 0) ? 1.4*minTime/real : 10.;
+      if (factor > 10.) factor = 10.;
+      if (factor < 1.5) factor = 1.5;
+      iterations = static_cast<size_t>(iterations*factor) + 1;
+    }
+    Result r;
+    r.fName = bench.GetName();
+    r.fIterations = iterations;
+    r.fRealTime = 1e9*real/iterations;
+    r.fCpuTime = 1e9*cpu/iterations;
+    r.fSamplesPerSecond = (real > 0) ? bench.GetSamples()*iterations/real : 0.;
+    r.fWaveformsPerSecond = (real > 0) ? bench.GetWaveforms()*iterations/real : 0.;
+    return r;
+  }
+
+  void WriteJSON(FILE* out, const std::vector<Result>& results, double minTime)
+  {
+    char date[64];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"executable\": \"WaveBench\",\n");
+#ifdef HAVE_FFTW
+    fprintf(out, "    \"fftw\": true,\n");
+#else
+    fprintf(out, "    \"fftw\": false,\n");
+#endif
+    fprintf(out, "    \"min_time\": %g\n  },\n", minTime);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i=0;i<results.size();i++) {
+      const Result& r = results[i];
+      fprintf(out, "    {\n");
+      fprintf(out, "      \"name\": \"%s\",\n", r.fName.c_str());
+      fprintf(out, "      \"iterations\": %lu,\n", (unsigned long)r.fIterations);
+      fprintf(out, "      \"real_time\": %.6g,\n", r.fRealTime);
+      fprintf(out, "      \"cpu_time\": %.6g,\n", r.fCpuTime);
+      fprintf(out, "      \"time_unit\": \"ns\",\n");
+      fprintf(out, "      \"samples_per_second\": %.6g,\n", r.fSamplesPerSecond);
+      fprintf(out, "      \"waveforms_per_second\": %.6g\n", r.fWaveformsPerSecond);
+      fprintf(out, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+  }
+
+  void Usage()
+  {
+    fprintf(stderr,
+      "Usage: WaveBench [--filter=substring] [--min_time=seconds] [--out=file] [--list]\n");
+  }
+}
+
+//______________________________________________________________________________
+int main(int argc, char** argv)
+{
+  std::string filter;
+  std::string outName;
+  double minTime = 0.2;
+  bool list = false;
+  for (int i=1;i<argc;i++) {
+    if (strncmp(argv[i], "--filter=", 9) == 0) filter = argv[i] + 9;
+    else if (strncmp(argv[i], "--min_time=", 11) == 0) minTime = atof(argv[i] + 11);
+    else if (strncmp(argv[i], "--out=", 6) == 0) outName = argv[i] + 6;
+    else if (strcmp(argv[i], "--list") == 0) list = true;
+    else {
+      Usage();
+      return 1;
+    }
+  }
+
+  std::vector<Benchmark*> benchmarks = MakeBenchmarks();
+  std::vector<Result> results;
+  for (size_t i=0;i<benchmarks.size();i++) {
+    Benchmark& b = *benchmarks[i];
+    if (!filter.empty() && b.GetName().find(filter) == std::string::npos) continue;
+    if (list) {
+      printf("%s\n", b.GetName().c_str());
+      continue;
+    }
+    Result r = Measure(b, minTime);
+    fprintf(stderr, "%-45s %12.1f ns %12.4g samples/s\n", r.fName.c_str(),
+            r.fRealTime, r.fSamplesPerSecond);
+    results.push_back(r);
+  }
+  for (size_t i=0;i<benchmarks.size();i++) delete benchmarks[i];
+  if (list) return 0;
+
+  FILE* out = stdout;
+  if (!outName.empty()) {
+    out = fopen(outName.c_str(), "w");
+    if (out == NULL) {
+      fprintf(stderr, "Unable to open %s\n", outName.c_str());
+      return 1;
+    }
+  }
+  WriteJSON(out, results, minTime);
+  if (out != stdout) fclose(out);
+  return 0;
+}
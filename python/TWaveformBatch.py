@@ -0,0 +1,107 @@
+"""
+Vectorised batch API for TWaveform.
+
+Runs the FFT, the transformers and the template fit over a 2-D array of
+waveforms (channels x samples) in one C++ call (see
+WaveBase/TWaveformBatch.hh):
+
+  import ROOT, numpy
+  ROOT.gSystem.Load("/path/to/libWaveWaveBase")
+  import TWaveformBatch
+
+  arr = numpy.zeros((nchannels, nsamples))
+  spectra = TWaveformBatch.fft(arr, freq)
+  traces = TWaveformBatch.ifft(spectra, nsamples, freq)
+  TWaveformBatch.transform(ROOT.TExpWindowAverage(), arr, freq)  # in place
+  offsets, errors = TWaveformBatch.fit_offsets(fit, arr, freq)
+
+Arrays are converted to C-contiguous float64 (complex128 for spectra); if
+they already are, no copy is made.  freq is in CLHEP units, the default is
+1 MHz as for a new waveform.
+
+The GIL is held during the calls on purpose: the FFTs come from the
+unlocked cache of TFastFourierTransformFFTW.GetFFT, whose scratch
+waveforms are shared per length, and the fits use Minuit, so two Python
+threads running batches (or any other TWaveform calls) at the same time
+would corrupt each other's results.  The speedup comes from running the
+loop over rows in C++, not from threads.
+
+A RuntimeError is raised if a row fails (e.g. a transformer that changes
+the length); the error itself is reported by TWaveformDiagnostics.
+"""
+import numpy
+import ROOT
+
+_batch = ROOT.TWaveformBatch
+
+
+def _default_freq(freq):
+    return ROOT.CLHEP.megahertz if freq is None else freq
+
+
+def _check_rows(done, nch, what):
+    if done != nch:
+        raise RuntimeError("%s failed at row %d of %d" % (what, done, nch))
+
+
+def _as_2d(arr, dtype):
+    arr = numpy.ascontiguousarray(arr, dtype=dtype)
+    if arr.ndim == 1:
+        arr = arr.reshape(1, -1)
+    if arr.ndim != 2:
+        raise ValueError("Expected a 2-D (channels x samples) array")
+    return arr
+
+
+def fft(arr, freq=None):
+    """Forward FFT of every row, returns (channels x samples/2+1) complex."""
+    arr = _as_2d(arr, numpy.float64)
+    nch, nsamp = arr.shape
+    out = numpy.empty((nch, nsamp // 2 + 1), dtype=numpy.complex128)
+    done = _batch.PerformFFT(arr.ctypes.data, out.ctypes.data, nch, nsamp,
+                             _default_freq(freq))
+    _check_rows(done, nch, "fft")
+    return out
+
+
+def ifft(spectra, nsamples, freq=None, normalize=False):
+    """
+    Inverse FFT of every row, returns (channels x nsamples).  Unnormalised
+    unless normalize is True, in which case ifft(fft(x)) == x.
+    """
+    spectra = _as_2d(spectra, numpy.complex128)
+    nch = spectra.shape[0]
+    if spectra.shape[1] != nsamples // 2 + 1:
+        raise ValueError("Spectra must have nsamples/2+1 columns")
+    out = numpy.empty((nch, nsamples), dtype=numpy.float64)
+    done = _batch.PerformInverseFFT(out.ctypes.data, spectra.ctypes.data,
+                                    nch, nsamples, _default_freq(freq),
+                                    normalize)
+    _check_rows(done, nch, "ifft")
+    return out
+
+
+def transform(transformer, arr, freq=None):
+    """
+    Apply a TVWaveformTransformer to every row.  Done in place if arr is a
+    C-contiguous float64 array, the result is returned in any case.
+    """
+    arr = _as_2d(arr, numpy.float64)
+    nch, nsamp = arr.shape
+    done = _batch.Transform(transformer, arr.ctypes.data, nch, nsamp,
+                            _default_freq(freq))
+    _check_rows(done, nch, "transform")
+    return arr
+
+
+def fit_offsets(fit, arr, freq=None):
+    """Fit every row with a TFitWaveforms, returns (offsets, errors)."""
+    arr = _as_2d(arr, numpy.float64)
+    nch, nsamp = arr.shape
+    offsets = numpy.empty(nch)
+    errors = numpy.empty(nch)
+    done = _batch.FitOffsets(fit, arr.ctypes.data, nch, nsamp,
+                             offsets.ctypes.data, errors.ctypes.data,
+                             _default_freq(freq))
+    _check_rows(done, nch, "fit_offsets")
+    return offsets, errors
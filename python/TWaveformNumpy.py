@@ -0,0 +1,161 @@
+"""
+NumPy bridge for TWaveform.
+
+Gives every TTemplWaveform instantiation (see WaveBase/LinkDef.h.in) and the
+TTemplWaveformView types an __array_interface__, so that NumPy sees the
+waveform samples directly, without a copy:
+
+  import ROOT, numpy
+  ROOT.gSystem.Load("/path/to/libWaveWaveBase")
+  import TWaveformNumpy
+  TWaveformNumpy.pythonize()
+
+  wf = ROOT.TShortWaveform()
+  ...
+  arr = numpy.asarray(wf)        # view, dtype int16, no copy
+
+Going the other way:
+
+  wf = TWaveformNumpy.from_array(arr)        # one memcpy, type from dtype
+  wf, arr = TWaveformNumpy.empty(ROOT.TDoubleWaveform, 1000)
+                                             # arr is a view of wf's storage,
+                                             # fill it in NumPy, no copy
+  view = TWaveformNumpy.view(arr)            # TTemplWaveformView backed by
+                                             # arr's memory, no copy
+
+A std::vector cannot adopt memory it did not allocate, so a waveform never
+uses NumPy-owned storage; use empty() to let NumPy write into a waveform,
+or view() when read-only access from C++ is enough.
+
+Arrays returned by asarray() and empty() are only valid as long as the
+waveform is alive and not resized.
+"""
+import ctypes
+import numpy
+import ROOT
+
+# Waveform class for each dtype, used by from_array()
+_waveform_classes = {
+    numpy.dtype(numpy.float64): "TTemplWaveform<double>",
+    numpy.dtype(numpy.float32): "TTemplWaveform<float>",
+    numpy.dtype(numpy.int32): "TTemplWaveform<int>",
+    numpy.dtype(numpy.uint16): "TTemplWaveform<unsigned short>",
+    numpy.dtype(numpy.int16): "TTemplWaveform<short>",
+    numpy.dtype(numpy.uint32): "TTemplWaveform<unsigned int>",
+    numpy.dtype(numpy.int8): "TTemplWaveform<char>",
+    numpy.dtype(numpy.complex128): "TTemplWaveform<complex<double> >",
+    numpy.dtype("u%d" % ctypes.sizeof(ctypes.c_ulong)): "TTemplWaveform<unsigned long>",
+}
+
+# View class for each dtype, used by view()
+_view_classes = {
+    numpy.dtype(numpy.float64): "TTemplWaveformView<double>",
+    numpy.dtype(numpy.float32): "TTemplWaveformView<float>",
+    numpy.dtype(numpy.int32): "TTemplWaveformView<int>",
+    numpy.dtype(numpy.uint16): "TTemplWaveformView<unsigned short>",
+    numpy.dtype(numpy.int16): "TTemplWaveformView<short>",
+    numpy.dtype(numpy.complex128): "TTemplWaveformView<complex<double> >",
+}
+
+
+def _interface(address, length, dtype, readonly):
+    if length == 0:
+        # NumPy rejects a NULL data pointer, use a private empty buffer
+        return numpy.empty(0, dtype=dtype).__array_interface__
+    return {"shape": (length,),
+            "typestr": numpy.dtype(dtype).str,
+            "data": (int(address), readonly),
+            "version": 3}
+
+
+def _waveform_interface(wf):
+    buf = ROOT.TWaveformBuffer
+    typestr = str(buf.GetTypeString(wf))
+    if typestr == "":
+        raise TypeError("Unknown waveform type %s" % type(wf).__name__)
+    return _interface(buf.GetAddress(wf), int(buf.GetLength(wf)), typestr, False)
+
+
+def _view_interface(view):
+    return _interface(ROOT.TWaveformBuffer.GetAddress(view), int(view.GetLength()),
+                      type(view)._TWaveformNumpy_dtype, True)
+
+
+class _Holder(object):
+    # Exposes an __array_interface__ and keeps its owner alive
+    def __init__(self, interface, owner):
+        self.__array_interface__ = interface
+        self._owner = owner
+
+
+def pythonize():
+    """Add __array_interface__ to all waveform and view classes."""
+    for name in _waveform_classes.values():
+        getattr(ROOT, name).__array_interface__ = property(_waveform_interface)
+    for dtype, name in _view_classes.items():
+        cls = getattr(ROOT, name)
+        cls._TWaveformNumpy_dtype = dtype
+        cls.__array_interface__ = property(_view_interface)
+
+
+def asarray(wf):
+    """Zero-copy NumPy view of the samples of a waveform or view."""
+    if isinstance(wf, ROOT.TObject):
+        return numpy.asarray(_Holder(_waveform_interface(wf), wf))
+    for dtype, name in _view_classes.items():
+        if isinstance(wf, getattr(ROOT, name)):
+            return numpy.asarray(_Holder(
+                _interface(ROOT.TWaveformBuffer.GetAddress(wf), int(wf.GetLength()),
+                           dtype, True), wf))
+    raise TypeError("Unknown waveform type %s" % type(wf).__name__)
+
+
+def from_array(arr, wf=None, freq=None, toffset=None):
+    """
+    Copy a 1-D array into a waveform with a single memcpy.  If wf is not
+    given, a waveform of the matching type is created from arr.dtype.
+    """
+    arr = numpy.ascontiguousarray(arr)
+    if arr.ndim != 1:
+        raise ValueError("Only 1-D arrays can be converted")
+    if wf is None:
+        if arr.dtype not in _waveform_classes:
+            raise TypeError("No waveform type for dtype %s" % arr.dtype)
+        wf = getattr(ROOT, _waveform_classes[arr.dtype])()
+    elif numpy.dtype(str(ROOT.TWaveformBuffer.GetTypeString(wf))) != arr.dtype:
+        raise TypeError("dtype %s does not match the waveform" % arr.dtype)
+    ROOT.TWaveformBuffer.CopyFrom(wf, arr.ctypes.data, len(arr))
+    if freq is not None:
+        wf.SetSamplingFreq(freq)
+    if toffset is not None:
+        wf.SetTOffset(toffset)
+    return wf
+
+
+def empty(cls, length):
+    """
+    Create a waveform of class cls and the given length, and return it
+    together with a NumPy view of its storage.  Filling the array fills the
+    waveform.
+    """
+    wf = cls()
+    ROOT.TWaveformBuffer.SetLength(wf, length)
+    return wf, asarray(wf)
+
+
+def view(arr, freq=None, toffset=0.0):
+    """
+    Return a TTemplWaveformView of a 1-D array, without a copy.  The view
+    keeps a reference to the array so that its memory stays alive.
+    """
+    arr = numpy.ascontiguousarray(arr)
+    if arr.ndim != 1:
+        raise ValueError("Only 1-D arrays can be viewed")
+    if arr.dtype not in _view_classes:
+        raise TypeError("No view type for dtype %s" % arr.dtype)
+    v = getattr(ROOT, _view_classes[arr.dtype])()
+    if freq is None:
+        freq = ROOT.CLHEP.megahertz
+    ROOT.TWaveformBuffer.MakeView(arr.ctypes.data, len(arr), freq, toffset, v)
+    v._TWaveformNumpy_base = arr
+    return v